@@ -0,0 +1,303 @@
+/*
+ * Benchmarks of the scheduling engines, simulate and the sweep.
+ * Prints one csv row per case to stdout:
+ *     suite,engine,queue,problem_size,slices,procs,task_order,proc_order,tasks,runs,best_seconds,mean_seconds,tasks_per_second,ns_per_event
+ * an event is one completed task, tasks_per_second and ns_per_event are computed from the best run.
+ *
+ * build (from simulation_framework):
+ *     g++ -std=c++17 -O2 -DNDEBUG -I. benchmark/engine_benchmark.cpp -o engine_benchmark -pthread
+ * usage:
+ *     engine_benchmark [--quick] [--suite engine|simulate|sweep] [--min_time seconds]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+#include <valarray>
+#include <vector>
+
+#include <smpp/smpp.hpp>
+#include <smpp/mmsim.hpp>
+#include <smpp/sweep.hpp>
+#include <smpp/workspace.hpp>
+#include <smpp/user_completion.hpp>
+#include <smpp/task_columns.hpp>
+
+namespace
+{
+    typedef smpp::SimpleTask	task;
+    typedef smpp::Processor		processor;
+
+    struct measurement
+    {
+        size_t	runs			= 0;
+        double	best_seconds	= 0;
+        double	mean_seconds	= 0;
+    };
+
+    struct case_description
+    {
+        std::string			suite;
+        std::string			engine;
+        std::string			queue;
+        size_t				problem_size	= 0;
+        std::list<size_t>	slices;
+        size_t				procs			= 0;
+        std::string			task_order;
+        std::string			proc_order;
+        size_t				tasks			= 0;
+    };
+
+    double min_time = 0.2;
+
+    // runs f at least 3 times and until min_time is spent, after one warm up run
+    template<typename F>
+    measurement measure(F&& f)
+    {
+        typedef std::chrono::steady_clock clock;
+        f();
+        measurement m;
+        double total = 0;
+        m.best_seconds = std::numeric_limits<double>::max();
+        while (m.runs < 3 || total < min_time)
+        {
+            const auto start = clock::now();
+            f();
+            const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+            m.best_seconds = std::min(m.best_seconds, seconds);
+            total += seconds;
+            ++m.runs;
+        }
+        m.mean_seconds = total / m.runs;
+        return m;
+    }
+
+    void report(const case_description& c, const measurement& m)
+    {
+        std::cout << c.suite << ',' << c.engine << ',' << c.queue << ',' << c.problem_size << ',';
+        bool first = true;
+        for (auto s : c.slices)
+        {
+            std::cout << (first ? "" : "-") << s;
+            first = false;
+        }
+        std::cout << ',' << c.procs << ',' << c.task_order << ',' << c.proc_order << ',' << c.tasks << ',' << m.runs << ',';
+        std::cout << m.best_seconds << ',' << m.mean_seconds << ',';
+        std::cout << c.tasks / m.best_seconds << ',' << m.best_seconds * 1e9 / std::max<size_t>(c.tasks, 1) << std::endl;
+    }
+
+    // heterogeneous unless asked otherwise, so simulate uses the event engine instead of the closed form
+    std::vector<processor> make_procs(const size_t n, const bool homogeneous = false)
+    {
+        std::vector<processor> procs;
+        procs.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            procs.emplace_back(1e10 * (homogeneous ? 1 : 1 + i % 3));
+        return procs;
+    }
+
+    /*
+     * smallest problem size from base up which gives every processor tasks_per_processor tasks on average,
+     * so many processors are measured in the steady state of the queue, not only in the first scheduling pass
+     */
+    size_t problem_size_for(const std::list<size_t>& slices, const size_t n_procs, const size_t base = 2000)
+    {
+        const size_t tasks_per_processor = 64;
+        const double needed = double(tasks_per_processor * n_procs);
+        size_t problem_size = base;
+        for (size_t n_tasks; (n_tasks = smpp::mmsim::calculate_number_of_tasks(problem_size, slices)) < needed; )
+            problem_size = std::max(problem_size + 1, size_t(std::ceil(problem_size * std::sqrt(needed / n_tasks))));
+        return problem_size;
+    }
+
+    template<typename F>
+    void with_orders(const std::string& order, F&& f)
+    {
+        if (order == "min")
+            f(std::less<task>(), std::less<processor>());
+        else
+            f(std::greater<task>(), std::greater<processor>());
+    }
+
+    template<typename F>
+    void with_queues(F&& f)
+    {
+        f("heap", smpp::TaskProcessorWithTransfer());
+        f("radix", smpp::TaskProcessorWithTransferRadixHeap());
+        f("tournament", smpp::TaskProcessorWithTransferTournamentTree());
+        f("calendar", smpp::TaskProcessorWithTransferCalendarQueue());
+    }
+
+    /*
+     * engine loop only: tasks and processors are sorted once, completions go to user_completion;
+     * event works on std::vector<SimpleTask>, event_columns on task_columns
+     */
+    void engine_suite(const bool quick)
+    {
+        const std::vector<std::list<size_t>> cells = quick
+            ? std::vector<std::list<size_t>>{ { 20, 40 } }
+            : std::vector<std::list<size_t>>{ { 100, 200 }, { 20, 40 }, { 10, 13 } };
+        const std::vector<size_t> proc_counts = quick ? std::vector<size_t>{ 4, 1024 } : std::vector<size_t>{ 1, 4, 64, 1024, 100000 };
+
+        for (auto& slices : cells)
+            for (auto n_procs : proc_counts)
+                for (auto order : { "min", "max" })
+                    with_orders(order, [&](auto task_order, auto proc_order)
+                    {
+                        const auto problem_size = problem_size_for(slices, n_procs);
+                        auto tasks = smpp::mmsim::create_tasks<task>(problem_size, slices);
+                        std::stable_sort(tasks.begin(), tasks.end(), task_order);
+                        auto procs = make_procs(n_procs);
+                        std::sort(procs.begin(), procs.end(), proc_order);
+
+                        smpp::task_columns columns;
+                        for (auto& t : tasks)
+                            columns.push_back(t);
+
+                        with_queues([&](const char* queue, const auto& tp)
+                        {
+                            typename std::decay_t<decltype(tp)>::task_queue p_queue;
+                            smpp::user_completion users;
+                            const auto m = measure([&]
+                            {
+                                users.reset(slices.size());
+                                tp(procs, tasks, p_queue, users);
+                            });
+                            report({ "engine", "event", queue, problem_size, slices, n_procs, order, order, tasks.size() }, m);
+
+                            typename std::decay_t<decltype(tp)>::column_queue c_queue;
+                            smpp::duration_table durations;
+                            const auto c = measure([&]
+                            {
+                                users.reset(slices.size());
+                                tp(procs, columns, c_queue, durations, [&users, &columns](const smpp::column_event& e)
+                                {
+                                    users.complete(columns.userid[e.task], e.time_end);
+                                });
+                            });
+                            report({ "engine", "event_columns", queue, problem_size, slices, n_procs, order, order, tasks.size() }, c);
+                        });
+                    });
+    }
+
+    /*
+     * one replicate with every engine, including shuffle, sorts and reduction
+     */
+    void simulate_suite(const bool quick)
+    {
+        const std::vector<std::list<size_t>> cells = quick
+            ? std::vector<std::list<size_t>>{ { 20, 40 } }
+            : std::vector<std::list<size_t>>{ { 100, 200 }, { 20, 40 }, { 10, 13 } };
+        const std::vector<size_t> proc_counts = quick ? std::vector<size_t>{ 4 } : std::vector<size_t>{ 4, 1024, 100000 };
+        const smpp::TaskProcessorWithTransfer tp;
+        const smpp::TaskRunProcessorWithTransfer run_tp;
+
+        for (auto& slices : cells)
+            for (auto n_procs : proc_counts)
+                for (auto homogeneous : { false, true })
+                    with_orders("min", [&](auto task_order, auto proc_order)
+                    {
+                        const auto problem_size = problem_size_for(slices, n_procs);
+                        const auto procs = make_procs(n_procs, homogeneous);
+                        const auto n_users = static_cast<task::userid_type>(slices.size());
+                        const auto n_tasks = smpp::mmsim::calculate_number_of_tasks(problem_size, slices);
+                        const std::string engine_suffix = homogeneous ? "_homogeneous" : "";
+                        uint64_t replicate = 0;
+
+                        smpp::SimulationWorkspace<smpp::TaskProcessorWithTransfer> workspace;
+                        report({ "simulate", "event" + engine_suffix, "heap", problem_size, slices, n_procs, "min", "min", n_tasks }, measure([&]
+                        {
+                            workspace.load_tasks(problem_size, slices);
+                            smpp::simulate(workspace, procs, proc_order, task_order, tp, n_users, true, false, smpp::random_stream(1, replicate++));
+                        }));
+                        report({ "simulate", "runs" + engine_suffix, "", problem_size, slices, n_procs, "min", "min", n_tasks }, measure([&]
+                        {
+                            smpp::simulate_runs(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slices), task_order, run_tp, n_users, true, smpp::random_stream(1, replicate++));
+                        }));
+                        report({ "simulate", "stream" + engine_suffix, "heap", problem_size, slices, n_procs, "min", "min", n_tasks }, measure([&]
+                        {
+                            smpp::simulate_stream(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slices), task_order, tp, n_users, true, smpp::random_stream(1, replicate++));
+                        }));
+                    });
+    }
+
+    /*
+     * two player sweep as main does it, on all cores
+     */
+    void sweep_suite(const bool quick)
+    {
+        const size_t problem_size = quick ? 1000 : 2000;
+        std::vector<size_t> slices;
+        for (size_t s = 50; s <= 500; s += quick ? 150 : 50)
+            slices.push_back(s);
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (auto i : slices)
+            for (auto j : slices)
+                pairs.emplace_back(i, j);
+        const size_t n_replicates = quick ? 2 : 10;
+        const auto procs = make_procs(4);
+        const smpp::TaskProcessorWithTransfer tp;
+
+        size_t n_tasks = 0;
+        for (auto& ij : pairs)
+            n_tasks += smpp::mmsim::calculate_number_of_tasks(problem_size, { ij.first, ij.second }) * n_replicates;
+
+        smpp::work_stealing_pool pool(std::max(1u, std::thread::hardware_concurrency()));
+        const auto m = measure([&]
+        {
+            smpp::run_sweep(pairs, n_replicates, pool,
+                [&](const std::pair<size_t, size_t>& ij, const size_t replicate)
+                {
+                    thread_local smpp::SimulationWorkspace<smpp::TaskProcessorWithTransfer> workspace;
+                    const std::list<size_t> cell{ ij.first, ij.second };
+                    workspace.load_tasks(problem_size, cell);
+                    return smpp::simulate(workspace, procs, std::less<processor>(), std::less<task>(), tp, 2, true, false, smpp::random_stream(ij.first * 1000 + ij.second, replicate));
+                },
+                [&](const std::pair<size_t, size_t>& ij)
+                {
+                    return smpp::mmsim::calculate_number_of_tasks(problem_size, { ij.first, ij.second });
+                },
+                [](const std::pair<size_t, size_t>&, std::vector<std::valarray<double>>)
+                {
+                });
+        });
+        report({ "sweep", "event", "heap", problem_size, { slices.front(), slices.back() }, procs.size(), "min", "min", n_tasks }, m);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool quick = false;
+    std::string suite;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if (std::strcmp(argv[i], "--suite") == 0 && i + 1 < argc)
+            suite = argv[++i];
+        else if (std::strcmp(argv[i], "--min_time") == 0 && i + 1 < argc)
+            min_time = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--quick] [--suite engine|simulate|sweep] [--min_time seconds]" << std::endl;
+            return 1;
+        }
+    }
+    if (quick && min_time > 0.05)
+        min_time = 0.05;
+
+    std::cout.precision(6);
+    std::cout << "suite,engine,queue,problem_size,slices,procs,task_order,proc_order,tasks,runs,best_seconds,mean_seconds,tasks_per_second,ns_per_event" << std::endl;
+    if (suite.empty() || suite == "engine")
+        engine_suite(quick);
+    if (suite.empty() || suite == "simulate")
+        simulate_suite(quick);
+    if (suite.empty() || suite == "sweep")
+        sweep_suite(quick);
+    return 0;
+}
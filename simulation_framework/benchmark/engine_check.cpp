@@ -0,0 +1,174 @@
+/*
+ * Checks that the engines the benchmark times compute the same user times as the event engine.
+ * Without shuffling every engine has to reproduce the event engine on stably sorted std::vector<SimpleTask> with the
+ * heap queue: the other queues, the columns engine and the stream engine exactly, the runs engine and the closed form of
+ * analytic::simulate up to rounding, since they sum durations in another order.
+ * With a seeded shuffle the columns engine is compared with itself over the queues and with the closed form,
+ * the other engines draw from the generator differently and can only agree in distribution.
+ * Prints one line per mismatch and a summary, exits with 1 if anything mismatched.
+ *
+ * build (from simulation_framework):
+ *     g++ -std=c++17 -O2 -DNDEBUG -I. benchmark/engine_check.cpp -o engine_check -pthread
+ * usage:
+ *     engine_check
+ */
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <string>
+#include <valarray>
+#include <vector>
+
+#include <smpp/smpp.hpp>
+#include <smpp/mmsim.hpp>
+#include <smpp/workspace.hpp>
+#include <smpp/user_completion.hpp>
+
+namespace
+{
+    typedef smpp::SimpleTask	task;
+    typedef smpp::Processor		processor;
+
+    // relative error left by summing the same durations in another order
+    const double rounding_tolerance = 1e-9;
+
+    size_t n_checks = 0;
+    size_t n_mismatches = 0;
+
+    std::string describe(const std::list<size_t>& slices, const size_t n_procs, const bool homogeneous, const std::string& order, const bool shuffle)
+    {
+        std::string s;
+        for (auto slice : slices)
+            s += (s.empty() ? "" : "-") + std::to_string(slice);
+        return s + ',' + std::to_string(n_procs) + (homogeneous ? ",homogeneous," : ",heterogeneous,") + order + (shuffle ? ",shuffled" : ",ordered");
+    }
+
+    void check(const std::string& engine, const std::string& description, const std::valarray<double>& expected, const std::valarray<double>& actual, const double tolerance)
+    {
+        ++n_checks;
+        double error = expected.size() == actual.size() ? 0 : 1;
+        for (size_t i = 0; i < std::min(expected.size(), actual.size()); ++i)
+            error = std::max(error, std::abs(actual[i] - expected[i]) / std::max(std::abs(expected[i]), 1e-300));
+        if (error > tolerance)
+        {
+            ++n_mismatches;
+            std::cout << "mismatch," << engine << ',' << description << ",relative_error=" << error << std::endl;
+        }
+    }
+
+    std::vector<processor> make_procs(const size_t n, const bool homogeneous)
+    {
+        std::vector<processor> procs;
+        procs.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            procs.emplace_back(1e10 * (homogeneous ? 1 : 1 + i % 3));
+        return procs;
+    }
+
+    template<typename F>
+    void with_orders(const std::string& order, F&& f)
+    {
+        if (order == "min")
+            f(std::less<task>(), std::less<processor>());
+        else
+            f(std::greater<task>(), std::greater<processor>());
+    }
+
+    template<typename F>
+    void with_queues(F&& f)
+    {
+        f("heap", smpp::TaskProcessorWithTransfer());
+        f("radix", smpp::TaskProcessorWithTransferRadixHeap());
+        f("tournament", smpp::TaskProcessorWithTransferTournamentTree());
+        f("calendar", smpp::TaskProcessorWithTransferCalendarQueue());
+    }
+
+    template<typename TaskOrder, typename ProcOrder>
+    void check_ordered(const size_t problem_size, const std::list<size_t>& slices, const std::vector<processor>& procs, TaskOrder task_order, ProcOrder proc_order, const std::string& description)
+    {
+        const auto n_users = static_cast<task::userid_type>(slices.size());
+        const smpp::TaskProcessorWithTransfer tp;
+
+        // simulate sorts unstably, tied tasks are put in creation order here as the other engines do
+        auto sorted_tasks = smpp::mmsim::create_tasks<task>(problem_size, slices);
+        std::stable_sort(sorted_tasks.begin(), sorted_tasks.end(), task_order);
+        auto sorted_procs = procs;
+        std::sort(sorted_procs.begin(), sorted_procs.end(), proc_order);
+
+        const auto event = [&](const auto& engine)
+        {
+            typename std::decay_t<decltype(engine)>::task_queue queue;
+            smpp::user_completion users;
+            users.reset(n_users);
+            engine(sorted_procs, sorted_tasks, queue, users);
+            return users.times();
+        };
+        const auto expected = event(tp);
+
+        with_queues([&](const std::string& queue, const auto& engine)
+        {
+            check("event_" + queue, description, expected, event(engine), 0);
+
+            smpp::SimulationWorkspace<std::decay_t<decltype(engine)>> workspace;
+            workspace.load_tasks(problem_size, slices);
+            check("event_columns_" + queue, description, expected, smpp::simulate(workspace, procs, proc_order, task_order, engine, n_users, false, true, smpp::random_stream(1, 0)), 0);
+            check("stream_" + queue, description, expected, smpp::simulate_stream(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slices), task_order, engine, n_users, false, smpp::random_stream(1, 0)), 0);
+        });
+
+        // the runs engine advances a processor by whole runs, or takes the closed form on homogeneous processors
+        check("runs", description, expected, smpp::simulate_runs(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slices), task_order, smpp::TaskRunProcessorWithTransfer(), n_users, false, smpp::random_stream(1, 0)), rounding_tolerance);
+
+        if (smpp::analytic::is_homogeneous(procs))
+        {
+            std::valarray<double> times(n_users);
+            // the closed form only covers non decreasing durations
+            if (smpp::analytic::simulate(sorted_procs, sorted_tasks, tp, times))
+                check("analytic", description, expected, times, rounding_tolerance);
+        }
+    }
+
+    template<typename TaskOrder, typename ProcOrder>
+    void check_shuffled(const size_t problem_size, const std::list<size_t>& slices, const std::vector<processor>& procs, TaskOrder task_order, ProcOrder proc_order, const std::string& description, const uint64_t seed)
+    {
+        const auto n_users = static_cast<task::userid_type>(slices.size());
+
+        smpp::SimulationWorkspace<smpp::TaskProcessorWithTransfer> reference;
+        reference.load_tasks(problem_size, slices);
+        const auto expected = smpp::simulate(reference, procs, proc_order, task_order, smpp::TaskProcessorWithTransfer(), n_users, true, true, smpp::random_stream(seed, 0));
+
+        with_queues([&](const std::string& queue, const auto& engine)
+        {
+            smpp::SimulationWorkspace<std::decay_t<decltype(engine)>> workspace;
+            workspace.load_tasks(problem_size, slices);
+            check("event_columns_" + queue, description, expected, smpp::simulate(workspace, procs, proc_order, task_order, engine, n_users, true, true, smpp::random_stream(seed, 0)), 0);
+            // without return_processed homogeneous processors take the closed form on the same shuffled order
+            if (smpp::analytic::is_homogeneous(procs))
+                check("analytic_columns_" + queue, description, expected, smpp::simulate(workspace, procs, proc_order, task_order, engine, n_users, true, false, smpp::random_stream(seed, 0)), rounding_tolerance);
+        });
+    }
+}
+
+int main()
+{
+    const std::vector<std::list<size_t>> cells{ { 20, 40 }, { 10, 13 }, { 100, 200 }, { 30, 30 }, { 7, 50, 300 } };
+    const std::vector<size_t> proc_counts{ 1, 4, 64 };
+    const std::vector<size_t> problem_sizes{ 300, 1000 };
+
+    std::cout.precision(6);
+    uint64_t seed = 1;
+    for (auto problem_size : problem_sizes)
+        for (auto& slices : cells)
+            for (auto n_procs : proc_counts)
+                for (auto homogeneous : { false, true })
+                    for (auto order : { "min", "max" })
+                        with_orders(order, [&](auto task_order, auto proc_order)
+                        {
+                            const auto procs = make_procs(n_procs, homogeneous);
+                            check_ordered(problem_size, slices, procs, task_order, proc_order, describe(slices, n_procs, homogeneous, order, false));
+                            check_shuffled(problem_size, slices, procs, task_order, proc_order, describe(slices, n_procs, homogeneous, order, true), seed++);
+                        });
+
+    std::cout << n_checks << " checks, " << n_mismatches << " mismatches" << std::endl;
+    return n_mismatches == 0 ? 0 : 1;
+}
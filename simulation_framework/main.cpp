@@ -1,9 +1,20 @@
 #include <list>
+#include <map>
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <functional>
+#include <sstream>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <array>
+#include <limits>
+#include <cmath>
+#include <cstdio>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
@@ -14,9 +25,22 @@
 #include <smpp/task.hpp>
 #include <smpp/processor.hpp>
 #include <smpp/task_processor.hpp>
+#include <smpp/sweep.hpp>
+#include <smpp/random.hpp>
+#include <smpp/workspace.hpp>
+#include <smpp/binary_log.hpp>
+#include <smpp/async_writer.hpp>
+#include <smpp/instrumentation.hpp>
+#include <smpp/result_cache.hpp>
+#include <smpp/equilibrium.hpp>
+#include <smpp/optimizer.hpp>
+#include <smpp/statistics.hpp>
 
 namespace po = boost::program_options;
 
+// counts allocations when built with SMPP_INSTRUMENTATION
+SMPP_INSTRUMENTATION_ALLOCATION_HOOKS
+
 template<typename It>
 void write_to_stream(std::ostream& stream, It begin, It end, std::string separator = "-")
 {
@@ -29,13 +53,48 @@ void write_to_stream(std::ostream& stream, It begin, It end, std::string separat
     }
 }
 
+template<typename F>
+void with_task_order(const std::string& priority, F&& f)
+{
+    if (priority == "min")
+        f(std::less<smpp::SimpleTask>());
+    else if (priority == "max")
+        f(std::greater<smpp::SimpleTask>());
+    else
+        throw po::validation_error(po::validation_error::invalid_option_value, "task_priority");
+}
+
+template<typename F>
+void with_proc_order(const std::string& priority, F&& f)
+{
+    if (priority == "min")
+        f(std::less<smpp::Processor>());
+    else if (priority == "max")
+        f(std::greater<smpp::Processor>());
+    else
+        throw po::validation_error(po::validation_error::invalid_option_value, "proc_priority");
+}
+
+template<typename F>
+void with_event_queue(const std::string& queue, const double bandwidth, const double ping, F&& f)
+{
+    if (queue == "heap")
+        f(smpp::TaskProcessorWithTransfer(bandwidth, ping));
+    else if (queue == "radix")
+        f(smpp::TaskProcessorWithTransferRadixHeap(bandwidth, ping));
+    else if (queue == "tournament")
+        f(smpp::TaskProcessorWithTransferTournamentTree(bandwidth, ping));
+    else if (queue == "calendar")
+        f(smpp::TaskProcessorWithTransferCalendarQueue(bandwidth, ping));
+    else
+        throw po::validation_error(po::validation_error::invalid_option_value, "event_queue");
+}
+
 int main(int argc, char* argv[])
 {
     typedef smpp::SimpleTask                task;
     typedef smpp::Processor                 processor;
-    typedef smpp::TaskProcessorWithTransfer	task_processor;
-
-    typedef std::function<std::vector<double>(const size_t, const std::vector<smpp::Processor>& procs, std::vector<smpp::SimpleTask>&&, const smpp::TaskProcessor&)> fsimulator;
+    typedef smpp::TaskRunProcessorWithTransfer	task_run_processor;
 
     try
     {
@@ -43,23 +102,38 @@ int main(int argc, char* argv[])
         desc.add_options()
             ("help"                 , "produce help message")
             ("sim_log"              , "log simulation data")
+            ("sim_log_format"       , po::value<std::string>()->default_value("text")           , "simulation log format (text - <output>.log, binary - <output>.binlog)")
+            ("decode_log"           , po::value<std::string>()                                  , "convert binary simulation log to csv (to output if set, stdout otherwise) and exit")
+            ("bounded_memory"       , "memory of a simulation doesn't grow with the number of tasks: tasks are generated as they are scheduled (event engine is replaced by stream), logs are written to a temporary file per cell while simulating and copied to the log in cell order (text only)")
             //general simulation params
             ("problem_size"         , po::value<size_t>()->required()                           , "problem size"                                                )
             ("nominal_mips"         , po::value<double>()->default_value(1e10)                  , "nominal mips value"                                          )
             ("mips"                 , po::value<std::vector<double>>()->required()->multitoken(), "cores mips values as multiplication of nominal"              )
             ("task_priority"        , po::value<std::string>()->default_value("min")            , "task scheduling priority"                                    )
             ("proc_priority"        , po::value<std::string>()->default_value("min")            , "processor choosing priority"                                 )
+            ("engine"               , po::value<std::string>()->default_value("event")          , "simulation engine (event - task by task, runs - runs of identical tasks at once, stream - tasks generated on demand)")
             // task processor
             ("bandwidth"            , po::value<double>()->default_value(8e8)                   , "bandwidth with each processing unit (one value for all)"     )
             ("ping"                 , po::value<double>()->default_value(1e-5)                  , "ping with each processing unit (one value for all)"          )
+            ("event_queue"          , po::value<std::string>()->default_value("heap")           , "event queue of task processor (heap, radix, tournament, calendar)")
             // slice params
             ("slices"               , po::value<std::vector<size_t>>()->multitoken()->required(), "slice params (min slice, max slice, step)"                   )
             ("fix_first"            , po::value<size_t>()->default_value(0)                     , "fixed first player strategy"                                 )
 
             ("randomize_count"      , po::value<size_t>()->default_value(1)                     , "how many times to simulate with shufling"                    )
+            ("precision"            , po::value<double>()->default_value(0)                     , "relative half width of the 95% confidence interval of every player's time, replicates of a cell are added until it's reached, randomize_count (at least 2) is the least number of them (0 - randomize_count replicates)")
+            ("max_replicates"       , po::value<size_t>()->default_value(1000)                  , "most replicates of a cell with precision"                    )
+            ("random_numbers"       , po::value<std::string>()->default_value("independent")    , "random numbers of shuffling (independent - every cell and replicate has its own, common - cells share the numbers of a replicate and a task draws its place from its identity, so tasks two cells share are placed alike and differences between cells are less noisy; event engine only)")
+            ("antithetic"           , "replicates come in pairs, every random draw of the second one of a pair mirrors the first one")
+            ("threads"              , po::value<size_t>()->default_value(1)                     , "number of simulation threads (0 - number of cores)"          )
+            ("seed"                 , po::value<uint64_t>()                                     , "master seed of shuffling (random if not set)"                )
             ("single_player"        , po::value<bool>()->default_value(false)                   , "make single player simulation"                               )
+            ("search"               , po::value<std::string>()->default_value("grid")           , "search (grid - every cell, equilibrium - two player cells needed to find equilibria, fix_first is ignored, optimize - single player slices needed to find the best one)")
+            ("max_support"          , po::value<size_t>()->default_value(2)                     , "largest support of mixed equilibria of the equilibrium search" )
+            ("start_slice"          , po::value<size_t>()                                       , "slice both players start the equilibrium search from, one of the slices (the middle one if not set); rows and columns the search adds are simulated whole, so games with large mixed equilibria save far less than pure ones")
 
             ("output"               , po::value<std::string>()->default_value("results.txt")    , "output file"                                                 )
+            ("cache"                , po::value<std::string>()                                  , "result cache file, simulations found in it are not repeated" )
             ;
 
         po::variables_map vm;
@@ -71,6 +145,25 @@ int main(int argc, char* argv[])
             return 0;
         }
 
+        if (vm.count("decode_log"))
+        {
+            std::ifstream log(vm["decode_log"].as<std::string>(), std::ios::binary);
+            if (!log.is_open())
+                throw std::runtime_error("couldn't open log file");
+            if (vm["output"].defaulted())
+            {
+                smpp::binary_log::decode_to_csv(log, std::cout);
+            }
+            else
+            {
+                std::ofstream csv(vm["output"].as<std::string>());
+                if (!csv.is_open())
+                    throw std::runtime_error("couldn't open file");
+                smpp::binary_log::decode_to_csv(log, csv);
+            }
+            return 0;
+        }
+
         po::notify(vm);
 
         const size_t problem_size = vm["problem_size"].as<size_t>();
@@ -86,27 +179,30 @@ int main(int argc, char* argv[])
 
         auto task_priority = vm["task_priority"].as<std::string>();
         std::transform(task_priority.begin(), task_priority.end(), task_priority.begin(), ::tolower);
-        task::comparator task_comparator;
-        if(task_priority == "min")
-            task_comparator = task::small_first();
-        else if (task_priority == "max")
-            task_comparator = task::large_first();
-        else
+        if (task_priority != "min" && task_priority != "max")
             throw po::validation_error(po::validation_error::invalid_option_value, "task_priority");
 
         auto proc_priority = vm["proc_priority"].as<std::string>();
         std::transform(proc_priority.begin(), proc_priority.end(), proc_priority.begin(), ::tolower);
-        processor::comparator proc_comparator;
-        if (proc_priority == "min")
-            proc_comparator = processor::slow_first();
-        else if (proc_priority == "max")
-            proc_comparator = processor::fast_first();
-        else
+        if (proc_priority != "min" && proc_priority != "max")
             throw po::validation_error(po::validation_error::invalid_option_value, "proc_priority");
 
+        auto engine = vm["engine"].as<std::string>();
+        std::transform(engine.begin(), engine.end(), engine.begin(), ::tolower);
+        if (engine != "event" && engine != "runs" && engine != "stream")
+            throw po::validation_error(po::validation_error::invalid_option_value, "engine");
+        // only event engine produces per task log, so logged simulations are always done with it, unless memory is bounded
+        const bool bounded_memory = vm.count("bounded_memory") > 0;
+        if (bounded_memory && engine == "event")
+            engine = "stream";
+
         const double bandwidth	= vm["bandwidth"].as<double>();
         const double ping		= vm["ping"].as<double>();
-        std::unique_ptr<task_processor> tp = std::make_unique<task_processor>(bandwidth, ping);
+        auto event_queue = vm["event_queue"].as<std::string>();
+        std::transform(event_queue.begin(), event_queue.end(), event_queue.begin(), ::tolower);
+        if (event_queue != "heap" && event_queue != "radix" && event_queue != "tournament" && event_queue != "calendar")
+            throw po::validation_error(po::validation_error::invalid_option_value, "event_queue");
+        const task_run_processor run_tp(bandwidth, ping);
 
         const std::vector<size_t> slices_arr = vm["slices"].as<std::vector<size_t>>();
         std::vector<size_t> slices;
@@ -128,10 +224,76 @@ int main(int argc, char* argv[])
 
         const size_t	randomize_count = vm["randomize_count"].as<size_t>();
         const bool		do_shuffle		= randomize_count != 0;
+        const double	precision		= vm["precision"].as<double>();
+        const size_t	max_replicates	= vm["max_replicates"].as<size_t>();
+        if (precision < 0)
+            throw po::validation_error(po::validation_error::invalid_option_value, "precision");
+        auto random_numbers = vm["random_numbers"].as<std::string>();
+        std::transform(random_numbers.begin(), random_numbers.end(), random_numbers.begin(), ::tolower);
+        if (random_numbers != "independent" && random_numbers != "common")
+            throw po::validation_error(po::validation_error::invalid_option_value, "random_numbers");
+        const bool		common_random_numbers	= random_numbers == "common";
+        // only the event engine orders all tasks before simulating, the others draw places in sequence and can't key them by task
+        if (common_random_numbers && engine != "event")
+            throw po::validation_error(po::validation_error::invalid_option_value, "random_numbers");
+        const bool		antithetic		= vm.count("antithetic") > 0;
+        const bool		adaptive		= precision > 0 && do_shuffle;
+        // antithetic pairs are never split, a confidence interval needs two independent samples, i.e. two pairs
+        size_t initial_replicates = adaptive ? std::max<size_t>(randomize_count, antithetic ? 4 : 2) : std::max<size_t>(randomize_count, 1);
+        if (antithetic && do_shuffle)
+            initial_replicates += initial_replicates % 2;
+        if (adaptive && max_replicates < initial_replicates)
+            throw po::validation_error(po::validation_error::invalid_option_value, "max_replicates");
         const bool		single_player	= vm["single_player"].as<bool>();
+        const size_t	n_threads		= vm["threads"].as<size_t>();
+        auto search = vm["search"].as<std::string>();
+        std::transform(search.begin(), search.end(), search.begin(), ::tolower);
+        if (search != "grid" && (search != "equilibrium" || single_player) && (search != "optimize" || !single_player))
+            throw po::validation_error(po::validation_error::invalid_option_value, "search");
+        const bool		equilibrium_search	= search == "equilibrium";
+        const bool		optimize_search		= search == "optimize";
+        const size_t	max_support			= vm["max_support"].as<size_t>();
+        size_t			start_index			= slices.size() / 2;
+        if (vm.count("start_slice"))
+        {
+            const auto s = std::find(slices.begin(), slices.end(), vm["start_slice"].as<size_t>());
+            if (s == slices.end())
+                throw po::validation_error(po::validation_error::invalid_option_value, "start_slice");
+            start_index = size_t(s - slices.begin());
+        }
+        const uint64_t	seed			= vm.count("seed") ? vm["seed"].as<uint64_t>() : smpp::random_stream::from_entropy()();
+
+        // everything a simulation result depends on except the cell, seed and replicate
+        smpp::fingerprint scenario;
+        scenario.add(uint64_t(problem_size));
+        for (auto& p : procs)
+            scenario.add(p.mips);
+        scenario.add(uint64_t(procs.size()));
+        scenario.add(bandwidth).add(ping);
+        scenario.add(task_priority).add(proc_priority).add(engine).add(event_queue);
+
+        std::unique_ptr<smpp::result_cache> cache;
+        if (vm.count("cache"))
+            cache = std::make_unique<smpp::result_cache>(vm["cache"].as<std::string>());
+        std::atomic<size_t> cache_hits{ 0 };
+        std::atomic<size_t> cache_misses{ 0 };
 
         const bool sim_log = vm.count("sim_log") > 0;
-        std::ofstream sim_log_file;
+        auto sim_log_format = vm["sim_log_format"].as<std::string>();
+        std::transform(sim_log_format.begin(), sim_log_format.end(), sim_log_format.begin(), ::tolower);
+        if (sim_log_format != "text" && sim_log_format != "binary")
+            throw po::validation_error(po::validation_error::invalid_option_value, "sim_log_format");
+        const bool binary_log = sim_log_format == "binary";
+        // a binary section starts with its size, it can't be written before the simulation is done
+        if (bounded_memory && sim_log && binary_log)
+            throw po::validation_error(po::validation_error::invalid_option_value, "sim_log_format");
+        // logs are kept with results and written in order of cells, with bounded memory they are written to a spill file
+        // per cell while simulating, and the result keeps its name
+        const bool buffered_log = sim_log && !bounded_memory;
+        std::atomic<size_t> n_spills{ 0 };
+        std::ofstream sim_log_stream;
+        std::optional<smpp::async_writer> sim_log_writer;
+        std::ostream sim_log_file(nullptr);
 
         std::string fname = vm["output"].as<std::string>();
         if (fname == "auto")
@@ -150,81 +312,518 @@ int main(int argc, char* argv[])
         }
         if (sim_log)
         {
-            sim_log_file = std::ofstream(fname + ".log");
+            if (binary_log)
+                sim_log_stream.open(fname + ".binlog", std::ios::binary);
+            else
+                sim_log_stream.open(fname + ".log");
+            // output is formatted on this thread and written to disk by a writer thread
+            sim_log_writer.emplace(sim_log_stream);
+            sim_log_file.rdbuf(&*sim_log_writer);
             sim_log_file.precision(20);
         }
 
-        std::ofstream file(fname);
-        file.precision(20);
-        if (!file.is_open())
+        std::ofstream file_stream(fname);
+        if (!file_stream.is_open())
             throw std::runtime_error("couldn't open file");
+        smpp::async_writer file_writer(file_stream);
+        std::ostream file(&file_writer);
+        file.precision(20);
 
-        file << "ProblemSize=" << problem_size << "|||NominalMips=" << nominal_mips << "|||Bandwidth=" << bandwidth << "|||Ping=" << ping << std::endl;
+        file << "ProblemSize=" << problem_size << "|||NominalMips=" << nominal_mips << "|||Bandwidth=" << bandwidth << "|||Ping=" << ping << "|||Seed=" << seed << '\n';
         file << "Slices=";
         write_to_stream(file, slices.begin(), slices.end());
-        file << std::endl;
+        file << '\n';
         file << "MipsMultipliers=";
         write_to_stream(file, mips.begin(), mips.end());
-        file << std::endl;
+        file << '\n';
 
+        if (sim_log && binary_log)
+        {
+            smpp::binary_log::header log_header;
+            log_header.problem_size	= problem_size;
+            log_header.nominal_mips	= nominal_mips;
+            log_header.bandwidth	= bandwidth;
+            log_header.ping			= ping;
+            log_header.seed			= seed;
+            log_header.mips			= mips;
+            log_header.write(sim_log_file);
+        }
 
-        if(single_player)
+
+        // orderings and event queue are template parameters of the simulation, the instantiation is chosen once here
+        auto sweep = [&](auto task_order, auto proc_order, const auto& tp)
         {
-            file << "Slice,Time" << std::endl;
-            for (const auto& i : slices)
+            // buffers of the event engine are reused by all simulations of a thread
+            typedef smpp::SimulationWorkspace<std::decay_t<decltype(tp)>> workspace_type;
+            auto thread_workspace = []() -> workspace_type&
+            {
+                thread_local workspace_type workspace;
+                return workspace;
+            };
+
+            // unlogged simulation with the chosen engine
+            auto simulate_times = [&](const std::list<size_t>& slice_sizes, const task::userid_type n_users, const bool shuffle, const smpp::random_stream& generator) -> std::valarray<double>
+            {
+                if (engine == "runs")
+                    return smpp::simulate_runs(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slice_sizes), task_order, run_tp, n_users, shuffle, generator);
+                if (engine == "stream")
+                    return smpp::simulate_stream(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slice_sizes), task_order, tp, n_users, shuffle, generator);
+                auto& workspace = thread_workspace();
+                workspace.load_tasks(problem_size, slice_sizes);
+                return smpp::simulate(workspace, procs, proc_order, task_order, tp, n_users, shuffle, false, generator);
+            };
+
+            // first replicate of each cell is logged, binary log holds the whole encoded section,
+            // with bounded memory log is the name of the spill file
+            struct replicate_result
+            {
+                std::valarray<double>	times;
+                std::string				log;
+            };
+            // every (cell, replicate) has its own random stream, so results don't depend on the order of simulations;
+            // with common random numbers the stream is the replicate's only and keyed by task, an antithetic pair shares the stream of its first replicate
+            auto simulate_replicate = [&](const std::list<size_t>& slice_sizes, const size_t replicate, const bool shuffle) -> replicate_result
             {
-                file << i << ',';
-                auto tasks = smpp::mmsim::create_tasks<task>(problem_size, { i});
-                auto result = simulate(procs, proc_comparator, tasks, task_comparator, *tp, 1, false, sim_log);
-                if(sim_log)
+                const auto n_users = static_cast<task::userid_type>(slice_sizes.size());
+                std::vector<uint64_t> coordinates;
+                if (!common_random_numbers)
+                    coordinates.assign(slice_sizes.begin(), slice_sizes.end());
+                coordinates.push_back(antithetic ? replicate / 2 : replicate);
+                auto generator = smpp::random_stream::for_coordinates(seed, coordinates);
+                if (common_random_numbers)
+                    generator = generator.keyed();
+                if (antithetic && replicate % 2 == 1)
+                    generator = generator.antithetic();
+                if ((!sim_log || replicate != 0) && cache)
                 {
-                    sim_log_file << "Log for slice=" << i << std::endl;
-                    std::for_each(result.second.begin(), result.second.end(),[&sim_log_file](auto& val)
+                    // without shuffle the result doesn't depend on the seed and all replicates are the same
+                    auto id = scenario;
+                    id.add(slice_sizes.begin(), slice_sizes.end()).add(uint64_t(shuffle));
+                    if (shuffle)
+                        id.add(seed).add(uint64_t(replicate));
+                    if (shuffle && common_random_numbers)
+                        id.add(random_numbers).add(std::string("keyed"));
+                    if (shuffle && antithetic)
+                        id.add(std::string("antithetic"));
+                    replicate_result result;
+                    if (cache->find(id.value(), result.times))
                     {
-                        sim_log_file << val << std::endl;
-                    });
+                        ++cache_hits;
+                        return result;
+                    }
+                    ++cache_misses;
+                    result.times = simulate_times(slice_sizes, n_users, shuffle, generator);
+                    cache->insert(id.value(), result.times);
+                    return result;
+                }
+                if (!sim_log || replicate != 0)
+                    return replicate_result{ simulate_times(slice_sizes, n_users, shuffle, generator), std::string() };
+
+                if (bounded_memory)
+                {
+                    std::string spill_name = fname + ".log." + std::to_string(n_spills++) + ".tmp";
+                    std::ofstream spill(spill_name);
+                    if (!spill.is_open())
+                        throw std::runtime_error("couldn't open file");
+                    spill.precision(20);
+                    auto times = smpp::simulate_stream(procs, proc_order, smpp::mmsim::create_task_runs<task>(problem_size, slice_sizes), task_order, tp, n_users, shuffle, generator,
+                        [&](const smpp::task_completition<task>& tc)
+                        {
+                            spill << tc << '\n';
+                        });
+                    spill.close();
+                    if (!spill)
+                        throw std::runtime_error("couldn't write output");
+                    return replicate_result{ std::move(times), std::move(spill_name) };
+                }
+
+                auto& workspace = thread_workspace();
+                workspace.load_tasks(problem_size, slice_sizes);
+                auto& times = smpp::simulate(workspace, procs, proc_order, task_order, tp, n_users, shuffle, true, generator);
+                const auto& completions = workspace.completions;
+                if (binary_log)
+                {
+                    smpp::binary_log::section_encoder encoder(procs.size());
+                    for (size_t i = 0; i < completions.size(); ++i)
+                        encoder.add(completions.record(i, workspace.tasks));
+                    return replicate_result{ times, encoder.section(slice_sizes) };
+                }
+                std::ostringstream log;
+                log.precision(20);
+                for (size_t i = 0; i < completions.size(); ++i)
+                    log << completions.record(i, workspace.tasks) << std::endl;
+                return replicate_result{ times, log.str() };
+            };
+
+            // replicates of a cell folded in replicate order, only the log of the first one is kept
+            const bool keep_paired = equilibrium_search && common_random_numbers && do_shuffle;
+            struct replicate_summary
+            {
+                std::vector<smpp::sample_summary>		times;
+                // independent samples of a user's time, replicates or the means of antithetic pairs, which give the confidence interval,
+                // kept for the equilibrium search with common random numbers, which pairs them across cells
+                std::vector<smpp::running_statistics>	independent;
+                std::vector<std::vector<double>>		paired;
+                std::valarray<double>					first_of_pair;
+                size_t									count	= 0;
+                std::string								log;
+            };
+            auto fold_replicate = [&](replicate_summary& summary, replicate_result&& result)
+            {
+                const auto& times = result.times;
+                if (summary.count == 0)
+                {
+                    summary.times.resize(times.size());
+                    summary.independent.resize(times.size());
+                    if (keep_paired)
+                        summary.paired.resize(times.size());
+                    summary.log = std::move(result.log);
+                }
+                auto add_independent = [&summary, keep_paired](const size_t u, const double time)
+                {
+                    summary.independent[u].add(time);
+                    if (keep_paired)
+                        summary.paired[u].push_back(time);
+                };
+                for (size_t u = 0; u < times.size(); ++u)
+                    summary.times[u].add(times[u]);
+                if (!(antithetic && do_shuffle))
+                    for (size_t u = 0; u < times.size(); ++u)
+                        add_independent(u, times[u]);
+                else if (summary.count % 2 == 0)
+                    summary.first_of_pair = times;
+                else
+                    for (size_t u = 0; u < times.size(); ++u)
+                        add_independent(u, (summary.first_of_pair[u] + times[u]) / 2);
+                ++summary.count;
+            };
+
+            // replicates to add to a cell until the confidence interval of every player's time is narrow enough;
+            // the half width shrinks with the square root of the count, so the count it needs is estimated from the
+            // replicates so far and at least a quarter more is added, a cell takes a few rounds
+            auto more_replicates = [&](const replicate_summary& summary) -> size_t
+            {
+                const size_t n = summary.count;
+                if (!adaptive || n >= max_replicates)
+                    return 0;
+                double needed = 0;
+                for (auto& stats : summary.independent)
+                {
+                    // half width of less than two samples is unknown, not 0
+                    const double half_width = stats.count() < 2 ? std::numeric_limits<double>::infinity() : stats.half_width();
+                    const double target = precision * std::abs(stats.mean());
+                    if (!std::isfinite(half_width))
+                        needed = std::max(needed, double(n + 1));
+                    else if (half_width > target)
+                        needed = std::max(needed, target > 0 ? n * std::pow(half_width / target, 2) : double(max_replicates));
+                }
+                if (needed == 0)
+                    return 0;
+                needed = std::min(needed, double(max_replicates));
+                size_t more = std::max(size_t(std::ceil(needed)) - n, std::max<size_t>(1, n / 4));
+                // whole pairs, a pair which doesn't fit under max_replicates is left out
+                if (antithetic)
+                    more += more % 2;
+                more = std::min(more, max_replicates - n);
+                if (antithetic)
+                    more -= more % 2;
+                return more;
+            };
+
+            // Tasks are ordered by complexity only and ties between players are shuffled, so (j, i) is (i, j)
+            // with the players swapped. Unlogged two player simulations are done once per unordered pair.
+            // Keys of common random numbers depend on the user, so swapped players would draw other numbers than (j, i).
+            const bool symmetric = (fix_first == 0 || equilibrium_search) && do_shuffle && !sim_log && !common_random_numbers;
+
+            // with bounded memory the log of a cell is its spill file, which is copied and removed
+            auto write_log = [&](const std::string& log)
+            {
+                if (!bounded_memory)
+                {
+                    sim_log_file << log;
+                    return;
+                }
+                {
+                    std::ifstream spill(log);
+                    if (!spill.is_open())
+                        throw std::runtime_error("couldn't open file");
+                    if (spill.peek() != std::ifstream::traits_type::eof())
+                        sim_log_file << spill.rdbuf();
                 }
-                file << result.first[0];
-                file << std::endl;
-                file.flush();
+                std::remove(log.c_str());
+            };
+            auto write_pair_log = [&](const size_t first, const size_t second, const std::string& log)
+            {
+                if (!binary_log)
+                    sim_log_file << "Log for slice1=" << first << "|slice2=" << second << '\n';
+                write_log(log);
+            };
+
+            smpp::work_stealing_pool pool(n_threads == 0 ? std::thread::hardware_concurrency() : n_threads);
+            // logs of cells done before an earlier one wait in memory, so fewer cells may run ahead of the output
+            const size_t max_ahead = buffered_log ? 2 * pool.size() : 0;
+            if (optimize_search)
+            {
+                std::vector<size_t> sorted_slices = slices;
+                std::sort(sorted_slices.begin(), sorted_slices.end());
+                sorted_slices.erase(std::unique(sorted_slices.begin(), sorted_slices.end()), sorted_slices.end());
+
+                auto evaluate = [&](const std::vector<size_t>& indices)
+                {
+                    std::vector<double> values;
+                    values.reserve(indices.size());
+                    smpp::run_sweep(indices, 1, pool,
+                        [&](const size_t i, const size_t replicate)
+                        {
+                            return simulate_replicate({ sorted_slices[i] }, replicate, false);
+                        },
+                        [&](const size_t i)
+                        {
+                            return smpp::mmsim::calculate_number_of_tasks(problem_size, sorted_slices[i]);
+                        },
+                        [&](const size_t i, std::vector<replicate_result> results)
+                        {
+                            if (sim_log && !binary_log)
+                                sim_log_file << "Log for slice=" << sorted_slices[i] << '\n';
+                            if (sim_log)
+                                write_log(results[0].log);
+                            values.push_back(results[0].times[0]);
+                        }, max_ahead);
+                    return values;
+                };
+                // slices whose time can't be below the time of another slice are not simulated
+                auto bound = [&](const size_t i)
+                {
+                    const auto bounds = smpp::mmsim::completion_time_bounds<task>(problem_size, { sorted_slices[i] }, procs, tp);
+                    return std::make_pair(bounds.lower[0], bounds.upper[0]);
+                };
+                smpp::optimizer::lazy_curve<decltype(evaluate), decltype(bound)> curve(sorted_slices.size(), evaluate, bound);
+                const auto best = smpp::optimizer::minimize(curve);
+
+                // explored slices in order, the optimum is the smallest time among them
+                file << "Slice,Time" << '\n';
+                for (auto& point : curve.explored())
+                    file << sorted_slices[point.first] << ',' << point.second << '\n';
+                if (!sorted_slices.empty())
+                    std::cerr << "Optimum: slice " << sorted_slices[best] << ", time " << curve(best) << ", " << curve.explored().size() << " of " << sorted_slices.size() << " slices simulated, "
+                        << curve.n_bounded() << " ruled out by bounds" << std::endl;
             }
-        }
-        else
-        {
-            file << "Slice First,Slice Second,Time First,Time Second" << std::endl;
-            const std::vector<size_t> v{ fix_first };
-            const std::vector<size_t>& f_s = fix_first == 0 ? slices : v;
-            for (const auto& i : f_s)
-                for (const auto&j : slices)
-                {
-                    file << i << ',' << j << ',';
-
-                    std::valarray<double> times_array;
-                    task_processor::return_type processed_tasks;
-                    auto tasks_main = smpp::mmsim::create_tasks<task>(problem_size, { i, j });
-                    std::tie(times_array, processed_tasks) = simulate(procs, proc_comparator, tasks_main, task_comparator, *tp, 2, do_shuffle, sim_log);
-                    if (sim_log)
+            else if(single_player)
+            {
+                file << "Slice,Time" << '\n';
+                smpp::run_sweep(slices, 1, pool,
+                    [&](const size_t i, const size_t replicate)
+                    {
+                        return simulate_replicate({ i }, replicate, false);
+                    },
+                    [&](const size_t i)
+                    {
+                        return smpp::mmsim::calculate_number_of_tasks(problem_size, i);
+                    },
+                    [&](const size_t i, std::vector<replicate_result> results)
+                    {
+                        if (sim_log && !binary_log)
+                            sim_log_file << "Log for slice=" << i << '\n';
+                        if (sim_log)
+                            write_log(results[0].log);
+                        file << i << ',' << results[0].times[0];
+                        file << '\n';
+                    }, max_ahead);
+            }
+            else if (equilibrium_search)
+            {
+                // cells are strategy indices, a cell is simulated when the search needs it for the first time,
+                // with symmetry (j, i) is taken from (i, j)
+                std::map<std::pair<size_t, size_t>, smpp::equilibrium::cell> simulated;
+                auto evaluate = [&](const std::vector<std::pair<size_t, size_t>>& cells)
+                {
+                    auto key_of = [&](const std::pair<size_t, size_t>& c)
                     {
-                        sim_log_file << "Log for slice1=" << i << "|slice2=" << j << std::endl;
-                        sim_log_file.flush();
-                        std::for_each(processed_tasks.begin(), processed_tasks.end(), [&sim_log_file](auto& val)
+                        return symmetric && c.first > c.second ? std::make_pair(c.second, c.first) : c;
+                    };
+                    std::vector<std::pair<size_t, size_t>> pairs;
+                    for (auto& c : cells)
+                    {
+                        const auto key = key_of(c);
+                        if (simulated.count(key) == 0 && std::find(pairs.begin(), pairs.end(), key) == pairs.end())
+                            pairs.push_back(key);
+                    }
+
+                    smpp::run_adaptive_sweep(pairs, initial_replicates, pool, replicate_summary(),
+                        [&](const std::pair<size_t, size_t>& ab, const size_t replicate)
                         {
-                            sim_log_file << val << std::endl;
-                        });
-                        sim_log_file.flush();
+                            return simulate_replicate({ slices[ab.first], slices[ab.second] }, replicate, do_shuffle);
+                        },
+                        [&](const std::pair<size_t, size_t>& ab)
+                        {
+                            return smpp::mmsim::calculate_number_of_tasks(problem_size, { slices[ab.first], slices[ab.second] });
+                        },
+                        fold_replicate,
+                        [&](const std::pair<size_t, size_t>&, const replicate_summary& summary)
+                        {
+                            return more_replicates(summary);
+                        },
+                        [&](const std::pair<size_t, size_t>& ab, replicate_summary summary)
+                        {
+                            if (sim_log)
+                                write_pair_log(slices[ab.first], slices[ab.second], summary.log);
+                            auto estimate_of = [&summary, keep_paired](const size_t u)
+                            {
+                                const auto& stats = summary.independent[u];
+                                return smpp::equilibrium::estimate{ stats.mean(), stats.half_width(), keep_paired ? std::move(summary.paired[u]) : std::vector<double>() };
+                            };
+                            simulated[ab] = { estimate_of(0), estimate_of(1) };
+                        }, max_ahead);
+
+                    std::vector<smpp::equilibrium::cell> values;
+                    values.reserve(cells.size());
+                    for (auto& c : cells)
+                    {
+                        auto value = simulated[key_of(c)];
+                        if (key_of(c) != c)
+                            std::swap(value.first, value.second);
+                        values.push_back(value);
                     }
-                    for (size_t times = 1; times < randomize_count; ++times)
+                    return values;
+                };
+
+                // cells which can't be a best response are not simulated
+                auto bound = [&](const size_t i, const size_t j)
+                {
+                    const auto bounds = smpp::mmsim::completion_time_bounds<task>(problem_size, { slices[i], slices[j] }, procs, tp);
+                    smpp::equilibrium::cell_bounds b;
+                    b.lower_first	= bounds.lower[0];
+                    b.lower_second	= bounds.lower[1];
+                    b.upper_first	= bounds.upper[0];
+                    b.upper_second	= bounds.upper[1];
+                    return b;
+                };
+                smpp::equilibrium::lazy_game<decltype(evaluate), decltype(bound)> game(slices.size(), evaluate, bound);
+                const auto equilibria = smpp::equilibrium::search(game, start_index, max_support);
+
+                auto write_support = [&](const smpp::equilibrium::mixed_strategy& strategy)
+                {
+                    bool first = true;
+                    for (auto& s : strategy)
                     {
-                        auto tasks = smpp::mmsim::create_tasks<task>(problem_size, { i, j });
-                        times_array += simulate(procs, proc_comparator, tasks, task_comparator, *tp, 2, do_shuffle).first;
+                        file << (first ? "" : " ") << slices[s.first] << ':' << s.second;
+                        first = false;
                     }
-                    if (randomize_count != 0)
-                        times_array /= randomize_count;
-                    file << times_array[0] << ',' << times_array[1];
-                    file << std::endl;
-                    file.flush();
+                };
+                file << "Support First,Support Second,Time First,Time Second,CI First,CI Second,Max Gain First,Max Gain Second" << '\n';
+                for (auto& e : equilibria)
+                {
+                    write_support(e.first);
+                    file << ',';
+                    write_support(e.second);
+                    file << ',' << e.time_first.mean << ',' << e.time_second.mean;
+                    file << ',' << e.time_first.half_width << ',' << e.time_second.half_width;
+                    file << ',' << e.max_gain_first << ',' << e.max_gain_second << '\n';
                 }
-        }
+                if (equilibria.empty())
+                    std::cerr << "No equilibrium with supports of at most " << max_support << " strategies was found" << std::endl;
+                const size_t n_cells = symmetric ? slices.size() * (slices.size() + 1) / 2 : slices.size() * slices.size();
+                std::cerr << "Equilibrium search: " << simulated.size() << " of " << n_cells << " cells simulated, "
+                    << game.n_bounded() << " ruled out by bounds" << std::endl;
+            }
+            else
+            {
+                // mean, standard deviation, half width of the 95% confidence interval of the mean, min, max and quantiles of replicates
+                typedef std::array<double, 8> replicate_stats;
+                struct cell_stats
+                {
+                    replicate_stats	first;
+                    replicate_stats	second;
+                    size_t			replicates;
+                };
+                file << "Slice First,Slice Second,Time First,Time Second,SD First,SD Second,CI First,CI Second,Min First,Min Second,Max First,Max Second,"
+                    "P5 First,P5 Second,Median First,Median Second,P95 First,P95 Second,Replicates" << '\n';
+                auto write_cell = [&](const size_t first, const size_t second, const replicate_stats& stats_first, const replicate_stats& stats_second, const size_t replicates)
+                {
+                    file << first << ',' << second;
+                    for (size_t k = 0; k < stats_first.size(); ++k)
+                        file << ',' << stats_first[k] << ',' << stats_second[k];
+                    file << ',' << replicates << '\n';
+                };
+
+                const std::vector<size_t> v{ fix_first };
+                const std::vector<size_t>& f_s = fix_first == 0 ? slices : v;
+                std::vector<std::pair<size_t, size_t>> pairs;
+                std::vector<std::pair<size_t, size_t>> pair_indices;
+                pairs.reserve(f_s.size() * slices.size());
+                for (size_t a = 0; a < f_s.size(); ++a)
+                    for (size_t b = symmetric ? a : 0; b < slices.size(); ++b)
+                    {
+                        pairs.emplace_back(f_s[a], slices[b]);
+                        pair_indices.emplace_back(a, b);
+                    }
+                std::map<std::pair<size_t, size_t>, cell_stats> mirrored;
+                size_t n_emitted = 0, n_replicates = 0, fewest = std::numeric_limits<size_t>::max(), most = 0;
+
+                smpp::run_adaptive_sweep(pairs, initial_replicates, pool, replicate_summary(),
+                    [&](const std::pair<size_t, size_t>& ij, const size_t replicate)
+                    {
+                        return simulate_replicate({ ij.first, ij.second }, replicate, do_shuffle);
+                    },
+                    [&](const std::pair<size_t, size_t>& ij)
+                    {
+                        return smpp::mmsim::calculate_number_of_tasks(problem_size, { ij.first, ij.second });
+                    },
+                    fold_replicate,
+                    [&](const std::pair<size_t, size_t>&, const replicate_summary& summary)
+                    {
+                        return more_replicates(summary);
+                    },
+                    [&](const std::pair<size_t, size_t>& ij, replicate_summary summary)
+                    {
+                        if (sim_log)
+                            write_pair_log(ij.first, ij.second, summary.log);
+                        // replicates were folded in their order, so the result doesn't depend on the number of threads
+                        auto stats_of = [&](const size_t user) -> replicate_stats
+                        {
+                            const auto& times = summary.times[user];
+                            const auto& m = times.moments;
+                            return { m.mean(), m.standard_deviation(), summary.independent[user].half_width(), m.min(), m.max(), times.low.value(), times.median.value(), times.high.value() };
+                        };
+                        const cell_stats stats{ stats_of(0), stats_of(1), summary.count };
+                        n_replicates += summary.count;
+                        fewest = std::min(fewest, summary.count);
+                        most = std::max(most, summary.count);
+
+                        const auto ab = pair_indices[n_emitted++];
+                        if (symmetric && ab.first == ab.second)
+                            for (size_t b = 0; b < ab.first; ++b)
+                            {
+                                auto m = mirrored.find({ b, ab.first });
+                                write_cell(slices[ab.first], slices[b], m->second.second, m->second.first, m->second.replicates);
+                                mirrored.erase(m);
+                            }
+                        if (symmetric && ab.first != ab.second)
+                            mirrored.emplace(ab, stats);
+                        write_cell(ij.first, ij.second, stats.first, stats.second, stats.replicates);
+                    }, max_ahead);
+                if (adaptive && !pairs.empty())
+                    std::cerr << "Replicates: " << n_replicates << " for " << pairs.size() << " cells, " << fewest << " to " << most << " per cell" << std::endl;
+            }
+        };
+
+        with_task_order(task_priority, [&](auto task_order)
+        {
+            with_proc_order(proc_priority, [&](auto proc_order)
+            {
+                with_event_queue(event_queue, bandwidth, ping, [&](const auto& tp)
+                {
+                    sweep(task_order, proc_order, tp);
+                });
+            });
+        });
+
+        file_writer.close();
+        if (sim_log_writer)
+            sim_log_writer->close();
+        if (cache)
+            std::cerr << "Cache: " << cache_hits << " results reused, " << cache_misses << " simulated" << std::endl;
+        smpp::instrumentation::report(std::cerr);
     }
     catch(const std::exception& ex)
     {
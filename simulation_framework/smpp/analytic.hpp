@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vector>
+#include <valarray>
+#include <algorithm>
+
+#include <smpp/processor.hpp>
+#include <smpp/task.hpp>
+#include <smpp/task_run.hpp>
+#include <smpp/task_processor.hpp>
+#include <smpp/random.hpp>
+
+namespace smpp
+{
+    namespace analytic
+    {
+        inline bool is_homogeneous(const std::vector<Processor>& procs)
+        {
+            return std::all_of(procs.begin(), procs.end(),
+                [&procs](const Processor& p) { return p.mips == procs.front().mips; });
+        }
+
+        /*
+         * Greedy schedule of tasks with non decreasing durations on identical processors.
+         * Every task ends not earlier than the previous one, so the processor which is free first is always
+         * the one which got its task n_procs positions ago: task k runs on processor k % n_procs and ends at
+         * the sum of durations of tasks k, k - n_procs, k - 2 * n_procs, ...
+         * Tasks are appended as segments of equal duration, so the end of any task costs O(segments).
+         */
+        class round_robin_schedule
+        {
+        public:
+            explicit round_robin_schedule(const size_t n_procs)
+                : n_procs(n_procs)
+            {
+
+            }
+
+            // returns false if segment breaks the non decreasing order of durations
+            bool append(const double duration, const size_t count)
+            {
+                if (count == 0)
+                    return true;
+                if (!segments.empty() && duration < segments.back().duration)
+                    return false;
+                segments.push_back(segment{ duration, n_tasks, n_tasks + count });
+                n_tasks += count;
+                return true;
+            }
+
+            double time_end(const size_t position) const
+            {
+                const auto proc = position % n_procs;
+                double result = 0.0;
+                for (auto& s : segments)
+                {
+                    if (s.begin > position)
+                        break;
+                    const auto end = std::min(s.end, position + 1);
+                    result += s.duration * (on_proc(end, proc) - on_proc(s.begin, proc));
+                }
+                return result;
+            }
+
+            size_t size() const
+            {
+                return n_tasks;
+            }
+
+        private:
+            // number of positions in [0, bound) which run on processor proc
+            size_t on_proc(const size_t bound, const size_t proc) const
+            {
+                return bound / n_procs + (bound % n_procs > proc ? 1 : 0);
+            }
+
+            struct segment
+            {
+                double duration;
+                size_t begin;
+                size_t end;
+            };
+
+            size_t					n_procs;
+            size_t					n_tasks = 0;
+            std::vector<segment>	segments;
+        };
+
+        /*
+         * tasks should be already ordered, Tasks is a std::vector<SimpleTask> or task_columns;
+         * returns false if durations are not non decreasing
+         */
+        template<typename Tasks, typename Engine>
+        bool simulate(
+            const std::vector<Processor>& procs,
+            const Tasks& tasks,
+            const Engine& tprocessor,
+            std::valarray<double>& times
+        )
+        {
+            round_robin_schedule schedule(procs.size());
+            for (size_t begin = 0; begin != tasks.size();)
+            {
+                const SimpleTask first = tasks[begin];
+                size_t end = begin + 1;
+                while (end != tasks.size() && tasks[end].complexity == first.complexity && tasks[end].bits_to_transfer == first.bits_to_transfer)
+                    ++end;
+                if (!schedule.append(tprocessor.time_to_process(procs.front(), first), end - begin))
+                    return false;
+                begin = end;
+            }
+
+            std::vector<bool> seen(times.size(), false);
+            size_t n_seen = 0;
+            for (size_t position = tasks.size(); position != 0 && n_seen != times.size(); --position)
+            {
+                const auto user = tasks[position - 1].userid;
+                if (!seen[user])
+                {
+                    seen[user] = true;
+                    ++n_seen;
+                    times[user] = schedule.time_end(position - 1);
+                }
+            }
+            return true;
+        }
+
+        /*
+         * groups should be already ordered, tasks of the runs inside one group are interleaved randomly;
+         * returns false if durations are not non decreasing
+         */
+        template<typename Engine, typename URNG>
+        bool simulate(
+            const std::vector<Processor>& procs,
+            const std::vector<task_run_group<SimpleTask>>& groups,
+            const Engine& tprocessor,
+            std::valarray<double>& times,
+            URNG& generator
+        )
+        {
+            round_robin_schedule schedule(procs.size());
+            std::vector<size_t> group_end;
+            group_end.reserve(groups.size());
+            for (auto& group : groups)
+            {
+                size_t n_tasks = 0;
+                for (auto& r : group)
+                    n_tasks += r.count;
+                if (!schedule.append(tprocessor.time_to_process(procs.front(), group.front().task), n_tasks))
+                    return false;
+                group_end.push_back(schedule.size());
+            }
+
+            // task ends are non decreasing, so the last task of the user is the last one in the order
+            std::vector<bool> seen(times.size(), false);
+            size_t n_seen = 0;
+            for (size_t g = groups.size(); g != 0 && n_seen != times.size(); --g)
+            {
+                auto& group = groups[g - 1];
+                std::vector<size_t> left;
+                std::vector<bool> pending;
+                size_t n_left = 0, n_pending = 0;
+                for (auto& r : group)
+                {
+                    left.push_back(r.count);
+                    n_left += r.count;
+                    pending.push_back(r.count != 0 && !seen[r.task.userid]);
+                    n_pending += pending.back() ? 1 : 0;
+                }
+
+                // draw owners of the group positions from the end without replacement
+                for (auto position = group_end[g - 1]; n_pending != 0; --position)
+                {
+                    size_t owner = 0;
+                    if (group.size() != 1)
+                    {
+                        auto draw = uniform_index(generator, n_left);
+                        while (draw >= left[owner])
+                            draw -= left[owner++];
+                    }
+                    --left[owner];
+                    --n_left;
+
+                    const auto user = group[owner].task.userid;
+                    if (pending[owner])
+                    {
+                        pending[owner] = false;
+                        --n_pending;
+                    }
+                    if (!seen[user])
+                    {
+                        seen[user] = true;
+                        ++n_seen;
+                        times[user] = schedule.time_end(position - 1);
+                    }
+                }
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace smpp
+{
+    /*
+     * Stream buffer which hands filled chunks to a writer thread, so formatting threads never wait for the disk.
+     * flush of the ostream hands over the current chunk, the target is flushed only by close.
+     * The producer waits only when all chunks are in flight, the writer sleeps until a chunk is handed over.
+     * Use as std::ostream out(&writer), from one thread at a time.
+     */
+    class async_writer : public std::streambuf
+    {
+    public:
+        static constexpr size_t alignment	= 4096;
+        static constexpr size_t max_chunks	= 8;
+
+        explicit async_writer(std::ostream& target, const size_t chunk_size = 1 << 20)
+            : target(target), chunk_size(chunk_size)
+        {
+            setp(nullptr, nullptr);
+            take_buffer();
+            writer = std::thread([this] { write(); });
+        }
+
+        async_writer(const async_writer&) = delete;
+        async_writer& operator=(const async_writer&) = delete;
+
+        ~async_writer()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+
+            }
+            for (auto b : buffers)
+                ::operator delete(b, std::align_val_t(alignment));
+        }
+
+        // writes everything, stops the writer thread, throws if the target failed
+        void close()
+        {
+            if (closed)
+                return;
+            hand_over(true);
+            closed = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+            }
+            chunk_ready.notify_one();
+            writer.join();
+            setp(nullptr, nullptr);
+            if (failed)
+                throw std::runtime_error("couldn't write output");
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (closed || !hand_over(false))
+                return traits_type::eof();
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override
+        {
+            return !closed && hand_over(false) ? 0 : -1;
+        }
+
+    private:
+        struct chunk
+        {
+            char*	data	= nullptr;
+            size_t	size	= 0;
+            bool	flush	= false;
+        };
+
+        // passes the written part of the current buffer to the writer, a flush without data keeps the buffer
+        bool hand_over(const bool flush)
+        {
+            chunk c{ pbase(), size_t(pptr() - pbase()), flush };
+            if (c.size == 0)
+            {
+                if (!flush)
+                    return !failed;
+                c.data = nullptr;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                filled_chunks.push_back(c);
+            }
+            chunk_ready.notify_one();
+            if (c.data != nullptr)
+                take_buffer();
+            return !failed;
+        }
+
+        void take_buffer()
+        {
+            char* buffer = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!empty_buffers.empty() || buffers.size() == max_chunks)
+                {
+                    buffer_free.wait(lock, [this] { return !empty_buffers.empty(); });
+                    buffer = empty_buffers.back();
+                    empty_buffers.pop_back();
+                }
+            }
+            if (buffer == nullptr)
+            {
+                buffer = static_cast<char*>(::operator new(chunk_size, std::align_val_t(alignment)));
+                buffers.push_back(buffer);
+            }
+            setp(buffer, buffer + chunk_size);
+        }
+
+        void write()
+        {
+            for (;;)
+            {
+                chunk c;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    chunk_ready.wait(lock, [this] { return !filled_chunks.empty() || done; });
+                    // done is set after the last chunk is handed over
+                    if (filled_chunks.empty())
+                        break;
+                    c = filled_chunks.front();
+                    filled_chunks.pop_front();
+                }
+
+                if (c.size != 0)
+                    target.write(c.data, c.size);
+                if (c.flush)
+                    target.flush();
+                if (!target)
+                    failed = true;
+                if (c.data != nullptr)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        empty_buffers.push_back(c.data);
+                    }
+                    buffer_free.notify_one();
+                }
+            }
+        }
+
+        std::ostream&					target;
+        const size_t					chunk_size;
+        std::vector<char*>				buffers;
+        bool							closed	= false;
+
+        // chunks handed over to the writer and buffers it has written
+        std::mutex						mutex;
+        std::condition_variable			chunk_ready;
+        std::condition_variable			buffer_free;
+        std::deque<chunk>				filled_chunks;
+        std::vector<char*>				empty_buffers;
+        bool							done	= false;
+        std::atomic<bool>				failed{ false };
+        std::thread						writer;
+    };
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <smpp/task.hpp>
+#include <smpp/task_completition.hpp>
+
+/*
+ * Binary simulation log.
+ *
+ * file:        header, then sections till the end of file
+ * header:      "SMPPLOG" version(1 byte) problem_size(u64) nominal_mips(f64) bandwidth(f64) ping(f64) seed(u64)
+ *              n_mips(varint) mips(f64 each)
+ * section:     'S' n_slices(varint) slices(varint each) n_records(varint) n_bytes(varint) records
+ * record:      worker * 2 + starts_at_worker_free(varint)
+ *              class(varint), a class which is seen first is followed by complexity(f64) bits_to_transfer(varint) userid(byte)
+ *              time_end - previous time_end in bits of the double, zigzag(varint)
+ *              time_start(f64) when it isn't the previous time_end of the worker
+ *
+ * u64 and f64 are little endian, every double is stored exactly.
+ */
+namespace smpp
+{
+    namespace binary_log
+    {
+        constexpr char		magic[]	= "SMPPLOG";
+        constexpr uint8_t	version	= 1;
+
+        inline uint64_t double_bits(const double value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        inline double bits_double(const uint64_t bits)
+        {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        inline void put_varint(std::string& out, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(char(uint8_t(value) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(char(value));
+        }
+
+        inline void put_fixed64(std::string& out, uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i, value >>= 8)
+                out.push_back(char(uint8_t(value)));
+        }
+
+        inline void put_double(std::string& out, const double value)
+        {
+            put_fixed64(out, double_bits(value));
+        }
+
+        // reads values written by put_* from a stream through a buffer of fixed size, throws on truncated data
+        class reader
+        {
+        public:
+            explicit reader(std::istream& in, const size_t buffer_size = 1 << 16)
+                : in(in), buffer(buffer_size)
+            {
+
+            }
+
+            uint8_t byte()
+            {
+                if (current == end && !fill())
+                    throw std::runtime_error("truncated simulation log");
+                ++n_read;
+                return uint8_t(*current++);
+            }
+
+            uint64_t varint()
+            {
+                uint64_t value = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    const uint8_t b = byte();
+                    value |= uint64_t(b & 0x7F) << shift;
+                    if ((b & 0x80) == 0)
+                        return value;
+                }
+                throw std::runtime_error("bad varint in simulation log");
+            }
+
+            uint64_t fixed64()
+            {
+                uint64_t value = 0;
+                for (int i = 0; i < 8; ++i)
+                    value |= uint64_t(byte()) << (8 * i);
+                return value;
+            }
+
+            double real()
+            {
+                return bits_double(fixed64());
+            }
+
+            bool empty()
+            {
+                return current == end && !fill();
+            }
+
+            // bytes read so far
+            uint64_t position() const
+            {
+                return n_read;
+            }
+
+        private:
+            bool fill()
+            {
+                in.read(buffer.data(), std::streamsize(buffer.size()));
+                current = buffer.data();
+                end = current + in.gcount();
+                return current != end;
+            }
+
+            std::istream&		in;
+            std::vector<char>	buffer;
+            const char*			current	= nullptr;
+            const char*			end		= nullptr;
+            uint64_t			n_read	= 0;
+        };
+
+        struct header
+        {
+            void write(std::ostream& stream) const
+            {
+                std::string out(magic);
+                out.push_back(char(version));
+                put_fixed64(out, problem_size);
+                put_double(out, nominal_mips);
+                put_double(out, bandwidth);
+                put_double(out, ping);
+                put_fixed64(out, seed);
+                put_varint(out, mips.size());
+                for (auto m : mips)
+                    put_double(out, m);
+                stream.write(out.data(), out.size());
+            }
+
+            uint64_t			problem_size	= 0;
+            double				nominal_mips	= 0;
+            double				bandwidth		= 0;
+            double				ping			= 0;
+            uint64_t			seed			= 0;
+            std::vector<double>	mips;
+        };
+
+        /*
+         * encodes completions of one simulation in completion order into a section
+         */
+        class section_encoder
+        {
+        public:
+            explicit section_encoder(const size_t n_workers)
+                : worker_free(n_workers, 0.0)
+            {
+
+            }
+
+            template<typename Task>
+            void add(const task_completition<Task>& tc)
+            {
+                const auto& task = get_ref(tc.task);
+                const bool starts_at_free = tc.time_start == worker_free[tc.worker_index];
+                put_varint(records, uint64_t(tc.worker_index) * 2 + (starts_at_free ? 1 : 0));
+
+                size_t class_id = 0;
+                while (class_id < classes.size() && !same_class(classes[class_id], task))
+                    ++class_id;
+                put_varint(records, class_id);
+                if (class_id == classes.size())
+                {
+                    classes.push_back(task);
+                    put_double(records, task.complexity);
+                    put_varint(records, task.bits_to_transfer);
+                    records.push_back(char(task.userid));
+                }
+
+                const int64_t delta = int64_t(double_bits(tc.time_end) - double_bits(previous_end));
+                put_varint(records, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+                if (!starts_at_free)
+                    put_double(records, tc.time_start);
+
+                previous_end = tc.time_end;
+                worker_free[tc.worker_index] = tc.time_end;
+                ++n_records;
+            }
+
+            template<typename Slices>
+            std::string section(const Slices& slices) const
+            {
+                std::string out(1, 'S');
+                put_varint(out, std::distance(std::begin(slices), std::end(slices)));
+                for (auto s : slices)
+                    put_varint(out, s);
+                put_varint(out, n_records);
+                put_varint(out, records.size());
+                out += records;
+                return out;
+            }
+
+        private:
+            static bool same_class(const SimpleTask& l, const SimpleTask& r)
+            {
+                return l.complexity == r.complexity && l.bits_to_transfer == r.bits_to_transfer && l.userid == r.userid;
+            }
+
+            std::vector<double>		worker_free;
+            std::vector<SimpleTask>	classes;
+            std::string				records;
+            double					previous_end	= 0.0;
+            size_t					n_records		= 0;
+        };
+
+        /*
+         * writes the log as csv: slices,time_start,time_end,worker_index,complexity,bits_to_transfer,userid
+         * preceded by the run parameters line of the results file
+         * the log is read as it's decoded, memory doesn't depend on its size
+         */
+        inline void decode_to_csv(std::istream& in, std::ostream& out)
+        {
+            reader r(in);
+
+            for (size_t i = 0; i < sizeof(magic) - 1; ++i)
+                if (r.byte() != uint8_t(magic[i]))
+                    throw std::runtime_error("not a simulation log");
+            if (r.byte() != version)
+                throw std::runtime_error("unsupported simulation log version");
+
+            header h;
+            h.problem_size	= r.fixed64();
+            h.nominal_mips	= r.real();
+            h.bandwidth		= r.real();
+            h.ping			= r.real();
+            h.seed			= r.fixed64();
+            h.mips.resize(r.varint());
+            for (auto& m : h.mips)
+                m = r.real();
+
+            out.precision(20);
+            out << "ProblemSize=" << h.problem_size << "|||NominalMips=" << h.nominal_mips << "|||Bandwidth=" << h.bandwidth << "|||Ping=" << h.ping << "|||Seed=" << h.seed << std::endl;
+            out << "Slices,TimeStart,TimeEnd,Worker,Complexity,BitsToTransfer,User" << std::endl;
+
+            while (!r.empty())
+            {
+                if (r.byte() != 'S')
+                    throw std::runtime_error("bad section in simulation log");
+                std::string slices;
+                const auto n_slices = r.varint();
+                for (uint64_t i = 0; i < n_slices; ++i)
+                    slices += (i == 0 ? "" : "-") + std::to_string(r.varint());
+
+                const auto n_records = r.varint();
+                // size of records in bytes, lets readers skip sections
+                const auto n_bytes = r.varint();
+                const auto records_begin = r.position();
+
+                std::vector<double>		worker_free(h.mips.size(), 0.0);
+                std::vector<SimpleTask>	classes;
+                double previous_end = 0.0;
+                for (uint64_t i = 0; i < n_records; ++i)
+                {
+                    const auto worker_flag = r.varint();
+                    const size_t worker = worker_flag >> 1;
+                    if (worker >= worker_free.size())
+                        worker_free.resize(worker + 1, 0.0);
+
+                    const auto class_id = r.varint();
+                    if (class_id == classes.size())
+                    {
+                        const double complexity = r.real();
+                        const size_t bits = r.varint();
+                        classes.emplace_back(complexity, bits, SimpleTask::userid_type(r.byte()));
+                    }
+                    else if (class_id > classes.size())
+                        throw std::runtime_error("bad task class in simulation log");
+                    const auto& task = classes[class_id];
+
+                    const auto zigzag = r.varint();
+                    const int64_t delta = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+                    const double time_end = bits_double(double_bits(previous_end) + uint64_t(delta));
+                    const double time_start = (worker_flag & 1) ? worker_free[worker] : r.real();
+
+                    out << slices << ',' << time_start << ',' << time_end << ',' << worker << ',' << task << '\n';
+                    previous_end = time_end;
+                    worker_free[worker] = time_end;
+                }
+                if (r.position() - records_begin != n_bytes)
+                    throw std::runtime_error("bad section size in simulation log");
+            }
+            out.flush();
+        }
+    }
+}
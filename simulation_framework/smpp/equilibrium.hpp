@@ -0,0 +1,725 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/*
+ * Equilibria of the two player slice game without simulating the whole grid.
+ *
+ * Both players minimize their times, cell (i, j) holds the times of the first player choosing strategy i and
+ * the second choosing j. The search is a double oracle: an equilibrium of a restricted game of some rows R and
+ * columns C is found by Lemke-Howson after strictly dominated strategies are removed, best responses to it in
+ * the full game are added to R and C until no player can do better. Equilibria of the final restricted game,
+ * small supports by support enumeration and the ends of Lemke-Howson paths, are reported when they hold in the
+ * full game. A row is added with all its cells, which gives the second player's times
+ * against every column, and a column with all its cells gives the first player's times, so best responses
+ * and the final check against every strategy use only cells which are already simulated, or lower bounds of cells which
+ * can't be a best response anyway.
+ * Only rows and columns the search reaches are simulated, a few of them when there is a pure equilibrium. Every row and
+ * column the search adds is simulated whole, except cells ruled out by bounds, so games with large mixed equilibria, where
+ * it reaches most strategies, are not cut by an order of magnitude, often not even by half. The start strategy is the
+ * caller's, a strategy of the support saves the rows and columns the search would add on its way there.
+ */
+namespace smpp
+{
+    namespace equilibrium
+    {
+        // mean of replicates and half width of its 95% confidence interval; the independent samples are kept when cells
+        // share random numbers replicate by replicate, so that differences of cells are estimated from paired samples
+        struct estimate
+        {
+            double				mean		= 0;
+            double				half_width	= 0;
+            std::vector<double>	samples;
+        };
+
+        inline estimate estimate_of(const std::vector<double>& values)
+        {
+            estimate e;
+            if (values.empty())
+                return e;
+            for (auto v : values)
+                e.mean += v;
+            e.mean /= values.size();
+            if (values.size() > 1)
+            {
+                double sum_squares = 0;
+                for (auto v : values)
+                    sum_squares += (v - e.mean) * (v - e.mean);
+                e.half_width = 1.96 * std::sqrt(sum_squares / (values.size() - 1) / values.size());
+            }
+            return e;
+        }
+
+        struct cell
+        {
+            estimate	first;
+            estimate	second;
+        };
+
+        // strategy indices and their probabilities
+        typedef std::vector<std::pair<size_t, double>> mixed_strategy;
+
+        struct result
+        {
+            mixed_strategy	first;
+            mixed_strategy	second;
+            estimate		time_first;
+            estimate		time_second;
+            double			max_gain_first	= 0;	// lower end of the interval of the gain of the best deviation outside the support,
+            double			max_gain_second	= 0;	// above 0 only when a deviation is significantly better
+        };
+
+        // lower and upper bounds of the times of a cell
+        struct cell_bounds
+        {
+            double	lower_first		= 0;
+            double	lower_second	= 0;
+            double	upper_first		= std::numeric_limits<double>::infinity();
+            double	upper_second	= std::numeric_limits<double>::infinity();
+        };
+
+        // no bounds, every cell is simulated
+        struct unbounded
+        {
+            cell_bounds operator()(size_t, size_t) const
+            {
+                return cell_bounds();
+            }
+        };
+
+        /*
+         * cells of n x n game which are simulated on demand, a row or a column at a time;
+         * Evaluate(const std::vector<std::pair<size_t, size_t>>&) returns std::vector<cell> of the given cells
+         *
+         * A row is required for the second player's times against every column. Cell (i, j) of a required row whose column isn't
+         * required, and whose lower bound of the second player's time is above the upper bound or the time of another cell of the row,
+         * holds the lower bounds of both times without being simulated, likewise for columns and the first player's times.
+         * Such a cell only makes a deviation look better than it is; it's simulated when both its row and its column are required.
+         */
+        template<typename Evaluate, typename Bound = unbounded>
+        class lazy_game
+        {
+        public:
+            lazy_game(const size_t n, Evaluate evaluate, Bound bound = Bound())
+                : n(n), evaluate(std::move(evaluate)), bound(std::move(bound)), cells(n * n), state(n * n, unknown), row_required(n, false), column_required(n, false)
+            {
+
+            }
+
+            size_t size() const
+            {
+                return n;
+            }
+
+            size_t n_evaluated() const
+            {
+                return n_known;
+            }
+
+            // cells which hold lower bounds
+            size_t n_bounded() const
+            {
+                return n_lower;
+            }
+
+            const cell& operator()(const size_t i, const size_t j) const
+            {
+                return cells[i * n + j];
+            }
+
+            void require_row(const size_t i)
+            {
+                row_required[i] = true;
+                std::vector<std::pair<size_t, size_t>> line;
+                for (size_t j = 0; j < n; ++j)
+                    line.emplace_back(i, j);
+                require(line, true, [](const cell_bounds& b) { return std::make_pair(b.lower_second, b.upper_second); },
+                    [](const cell& c) { return c.second.mean; });
+            }
+
+            void require_column(const size_t j)
+            {
+                column_required[j] = true;
+                std::vector<std::pair<size_t, size_t>> line;
+                for (size_t i = 0; i < n; ++i)
+                    line.emplace_back(i, j);
+                require(line, false, [](const cell_bounds& b) { return std::make_pair(b.lower_first, b.upper_first); },
+                    [](const cell& c) { return c.first.mean; });
+            }
+
+        private:
+            enum cell_state : uint8_t { unknown, lower, exact };
+
+            /*
+             * line is a row or a column, own_bounds and own_time give the bounds and the time of the player
+             * who chooses along the line
+             */
+            template<typename OwnBounds, typename OwnTime>
+            void require(const std::vector<std::pair<size_t, size_t>>& line, const bool is_row, OwnBounds own_bounds, OwnTime own_time)
+            {
+                const auto& crossing = is_row ? column_required : row_required;
+                std::vector<cell_bounds> bounds(line.size());
+                double incumbent = std::numeric_limits<double>::infinity();
+                for (size_t k = 0; k < line.size(); ++k)
+                {
+                    const auto index = line[k].first * n + line[k].second;
+                    if (state[index] == exact)
+                    {
+                        incumbent = std::min(incumbent, own_time(cells[index]));
+                        continue;
+                    }
+                    bounds[k] = bound(line[k].first, line[k].second);
+                    incumbent = std::min(incumbent, own_bounds(bounds[k]).second);
+                }
+
+                std::vector<std::pair<size_t, size_t>> missing;
+                for (size_t k = 0; k < line.size(); ++k)
+                {
+                    const auto index = line[k].first * n + line[k].second;
+                    const auto across = is_row ? line[k].second : line[k].first;
+                    if (state[index] == exact)
+                        continue;
+                    if (!crossing[across] && own_bounds(bounds[k]).first > incumbent)
+                    {
+                        if (state[index] == unknown)
+                        {
+                            cells[index] = cell{ estimate{ bounds[k].lower_first, 0 }, estimate{ bounds[k].lower_second, 0 } };
+                            state[index] = lower;
+                            ++n_lower;
+                        }
+                        continue;
+                    }
+                    missing.push_back(line[k]);
+                }
+                if (missing.empty())
+                    return;
+
+                const auto values = evaluate(missing);
+                for (size_t k = 0; k < missing.size(); ++k)
+                {
+                    const auto index = missing[k].first * n + missing[k].second;
+                    if (state[index] == lower)
+                        --n_lower;
+                    cells[index] = values[k];
+                    state[index] = exact;
+                }
+                n_known += missing.size();
+            }
+
+            size_t					n;
+            Evaluate				evaluate;
+            Bound					bound;
+            std::vector<cell>		cells;
+            std::vector<cell_state>	state;
+            std::vector<bool>		row_required;
+            std::vector<bool>		column_required;
+            size_t					n_known = 0;
+            size_t					n_lower = 0;
+        };
+
+        namespace detail
+        {
+            constexpr double tolerance = 1e-9;
+
+            // solves a x = b in place by gaussian elimination with partial pivoting, false when a is singular
+            inline bool solve(std::vector<std::vector<double>> a, std::vector<double> b, std::vector<double>& x)
+            {
+                const size_t n = b.size();
+                for (size_t c = 0; c < n; ++c)
+                {
+                    size_t pivot = c;
+                    for (size_t r = c + 1; r < n; ++r)
+                        if (std::abs(a[r][c]) > std::abs(a[pivot][c]))
+                            pivot = r;
+                    if (std::abs(a[pivot][c]) < 1e-300)
+                        return false;
+                    std::swap(a[c], a[pivot]);
+                    std::swap(b[c], b[pivot]);
+                    for (size_t r = c + 1; r < n; ++r)
+                    {
+                        const double f = a[r][c] / a[c][c];
+                        for (size_t k = c; k < n; ++k)
+                            a[r][k] -= f * a[c][k];
+                        b[r] -= f * b[c];
+                    }
+                }
+                x.assign(n, 0);
+                for (size_t c = n; c-- > 0;)
+                {
+                    double sum = b[c];
+                    for (size_t k = c + 1; k < n; ++k)
+                        sum -= a[c][k] * x[k];
+                    x[c] = sum / a[c][c];
+                }
+                return true;
+            }
+
+            // probabilities over the support which make the opponent indifferent between its support strategies,
+            // times(o, s) is the opponent's time when it plays o against s
+            template<typename Times>
+            bool indifference(const std::vector<size_t>& support, const std::vector<size_t>& opponent_support, Times times, std::vector<double>& probabilities)
+            {
+                const size_t k = support.size();
+                std::vector<std::vector<double>> a(k + 1, std::vector<double>(k + 1, 0));
+                std::vector<double> b(k + 1, 0);
+                for (size_t r = 0; r < k; ++r)
+                {
+                    for (size_t c = 0; c < k; ++c)
+                        a[r][c] = times(opponent_support[r], support[c]);
+                    a[r][k] = -1;
+                }
+                for (size_t c = 0; c < k; ++c)
+                    a[k][c] = 1;
+                b[k] = 1;
+                std::vector<double> x;
+                if (!solve(std::move(a), std::move(b), x))
+                    return false;
+                probabilities.assign(x.begin(), x.begin() + k);
+                double sum = 0;
+                for (auto& p : probabilities)
+                {
+                    if (p < -1e-9)
+                        return false;
+                    p = p < 1e-9 ? 0.0 : p;
+                    sum += p;
+                }
+                for (auto& p : probabilities)
+                    p /= sum;
+                return true;
+            }
+
+            /*
+             * estimate of the sum of weight * cell over terms; when every cell keeps its samples they're paired replicate
+             * by replicate over the replicates all of them have, otherwise the cells are taken as independent
+             */
+            inline estimate combine(const std::vector<std::pair<double, const estimate*>>& terms)
+            {
+                size_t n_paired = terms.empty() ? 0 : std::numeric_limits<size_t>::max();
+                for (auto& t : terms)
+                    n_paired = std::min(n_paired, t.second->samples.size());
+                if (n_paired > 1)
+                {
+                    std::vector<double> values(n_paired, 0);
+                    for (auto& t : terms)
+                        for (size_t r = 0; r < n_paired; ++r)
+                            values[r] += t.first * t.second->samples[r];
+                    return estimate_of(values);
+                }
+
+                estimate e;
+                double variance = 0;
+                for (auto& t : terms)
+                {
+                    e.mean += t.first * t.second->mean;
+                    variance += t.first * t.first * t.second->half_width * t.second->half_width;
+                }
+                e.half_width = std::sqrt(variance);
+                return e;
+            }
+
+            // expected time of playing s against the mixed opponent
+            template<typename Times>
+            double expected(const size_t s, const mixed_strategy& opponent, Times times)
+            {
+                double sum = 0;
+                for (auto& o : opponent)
+                    sum += o.second * times(s, o.first);
+                return sum;
+            }
+
+            template<typename Times>
+            bool is_best_response(const mixed_strategy& own, const mixed_strategy& opponent, const std::vector<size_t>& strategies, Times times)
+            {
+                double value = 0;
+                for (auto& s : own)
+                    value += s.second * expected(s.first, opponent, times);
+                for (auto s : strategies)
+                    if (expected(s, opponent, times) < value - tolerance * std::max(1.0, std::abs(value)))
+                        return false;
+                return true;
+            }
+
+            // strategies which are strictly dominated in the restricted game are removed, iteratively
+            template<typename Times1, typename Times2>
+            void remove_dominated(std::vector<size_t>& rows, std::vector<size_t>& columns, Times1 times_first, Times2 times_second)
+            {
+                auto dominated = [](std::vector<size_t>& own, const std::vector<size_t>& opponent, auto times)
+                {
+                    for (size_t x = 0; x < own.size(); ++x)
+                        for (size_t y = 0; y < own.size(); ++y)
+                        {
+                            if (x == y)
+                                continue;
+                            bool better = true;
+                            for (auto o : opponent)
+                                better = better && times(own[y], o) < times(own[x], o);
+                            if (better)
+                            {
+                                own.erase(own.begin() + x);
+                                return true;
+                            }
+                        }
+                    return false;
+                };
+                auto column_player_times = [&times_second](const size_t column, const size_t row) { return times_second(row, column); };
+                while (dominated(rows, columns, times_first) || dominated(columns, rows, column_player_times))
+                {
+
+                }
+            }
+
+            inline bool same_strategy(const mixed_strategy& l, const mixed_strategy& r)
+            {
+                if (l.size() != r.size())
+                    return false;
+                for (size_t i = 0; i < l.size(); ++i)
+                    if (l[i].first != r[i].first || std::abs(l[i].second - r[i].second) > 1e-6)
+                        return false;
+                return true;
+            }
+
+            // next k-combination of indices 0..n-1 in lexicographic order, false after the last one
+            inline bool next_combination(std::vector<size_t>& indices, const size_t n)
+            {
+                const size_t k = indices.size();
+                for (size_t i = k; i-- > 0;)
+                    if (indices[i] != n - k + i)
+                    {
+                        ++indices[i];
+                        for (size_t j = i + 1; j < k; ++j)
+                            indices[j] = indices[j - 1] + 1;
+                        return true;
+                    }
+                return false;
+            }
+        }
+
+        /*
+         * All equilibria of the restricted game rows x columns with supports of at most max_support strategies,
+         * times_first(i, j) and times_second(i, j) are the times of the players at cell (i, j)
+         */
+        template<typename Times1, typename Times2>
+        std::vector<std::pair<mixed_strategy, mixed_strategy>> support_enumeration(
+            std::vector<size_t> rows, std::vector<size_t> columns,
+            Times1 times_first, Times2 times_second,
+            const size_t max_support
+        )
+        {
+            detail::remove_dominated(rows, columns, times_first, times_second);
+            auto column_player_times = [&times_second](const size_t column, const size_t row) { return times_second(row, column); };
+
+            std::vector<std::pair<mixed_strategy, mixed_strategy>> found;
+            const size_t k_max = std::min({ max_support, rows.size(), columns.size() });
+            for (size_t k = 1; k <= k_max; ++k)
+            {
+                std::vector<size_t> row_index(k), column_index(k);
+                std::iota(row_index.begin(), row_index.end(), 0);
+                for (;;)
+                {
+                    std::vector<size_t> row_support;
+                    for (auto r : row_index)
+                        row_support.push_back(rows[r]);
+
+                    std::iota(column_index.begin(), column_index.end(), 0);
+                    for (;;)
+                    {
+                        std::vector<size_t> column_support;
+                        for (auto c : column_index)
+                            column_support.push_back(columns[c]);
+
+                        // first player's mix makes the second indifferent and the other way around
+                        std::vector<double> p, q;
+                        if (detail::indifference(row_support, column_support, column_player_times, p)
+                            && detail::indifference(column_support, row_support, times_first, q))
+                        {
+                            mixed_strategy first, second;
+                            for (size_t i = 0; i < k; ++i)
+                                if (p[i] > 0)
+                                    first.emplace_back(row_support[i], p[i]);
+                            for (size_t i = 0; i < k; ++i)
+                                if (q[i] > 0)
+                                    second.emplace_back(column_support[i], q[i]);
+                            if (first.size() == k && second.size() == k
+                                && detail::is_best_response(first, second, rows, times_first)
+                                && detail::is_best_response(second, first, columns, column_player_times))
+                            {
+                                std::sort(first.begin(), first.end());
+                                std::sort(second.begin(), second.end());
+                                found.emplace_back(std::move(first), std::move(second));
+                            }
+                        }
+
+                        if (!detail::next_combination(column_index, columns.size()))
+                            break;
+                    }
+                    if (!detail::next_combination(row_index, rows.size()))
+                        break;
+                }
+            }
+            return found;
+        }
+
+        /*
+         * One equilibrium of the restricted game rows x columns by Lemke-Howson, which finds it in degenerate games
+         * and for any support size, dropped is the label the path starts from: a row index in rows, or rows.size()
+         * plus a column index. Ties of the ratio test are broken lexicographically. Empty strategies when the path
+         * doesn't end within the pivot limit.
+         */
+        template<typename Times1, typename Times2>
+        std::pair<mixed_strategy, mixed_strategy> lemke_howson(
+            const std::vector<size_t>& rows, const std::vector<size_t>& columns,
+            Times1 times_first, Times2 times_second,
+            const size_t dropped
+        )
+        {
+            const size_t m = rows.size(), n = columns.size();
+            // times are costs, payoffs are made positive: largest time - time + 1
+            double max_first = -std::numeric_limits<double>::max(), max_second = max_first;
+            for (auto r : rows)
+                for (auto c : columns)
+                {
+                    max_first = std::max(max_first, times_first(r, c));
+                    max_second = std::max(max_second, times_second(r, c));
+                }
+
+            // tableau of each polytope: a row per basic variable, a column per label and the right hand side;
+            // label i < m is the first player's strategy i (its slack in the second player's tableau), m + j the second's
+            typedef std::vector<std::vector<double>> tableau;
+            tableau first(n, std::vector<double>(m + n + 1, 0)), second(m, std::vector<double>(m + n + 1, 0));
+            std::vector<size_t> first_basis(n), second_basis(m);
+            for (size_t j = 0; j < n; ++j)
+            {
+                for (size_t i = 0; i < m; ++i)
+                    first[j][i] = max_second - times_second(rows[i], columns[j]) + 1;
+                first[j][m + j] = 1;
+                first[j][m + n] = 1;
+                first_basis[j] = m + j;
+            }
+            for (size_t i = 0; i < m; ++i)
+            {
+                second[i][i] = 1;
+                for (size_t j = 0; j < n; ++j)
+                    second[i][m + j] = max_first - times_first(rows[i], columns[j]) + 1;
+                second[i][m + n] = 1;
+                second_basis[i] = i;
+            }
+
+            // pivots entering into t, returns the label which leaves
+            auto pivot = [m, n](tableau& t, std::vector<size_t>& basis, const size_t entering, const size_t first_slack, const size_t n_slacks)
+            {
+                size_t leave = t.size();
+                for (size_t r = 0; r < t.size(); ++r)
+                {
+                    if (t[r][entering] <= 1e-12)
+                        continue;
+                    if (leave == t.size())
+                    {
+                        leave = r;
+                        continue;
+                    }
+                    // lexicographic minimum of (rhs, slack columns) / entering column
+                    const double a = t[r][entering], b = t[leave][entering];
+                    double diff = t[r][m + n] / a - t[leave][m + n] / b;
+                    for (size_t k = 0; std::abs(diff) <= 1e-12 && k < n_slacks; ++k)
+                        diff = t[r][first_slack + k] / a - t[leave][first_slack + k] / b;
+                    if (diff < 0)
+                        leave = r;
+                }
+                if (leave == t.size())
+                    return m + n;
+                const double p = t[leave][entering];
+                for (auto& v : t[leave])
+                    v /= p;
+                for (size_t r = 0; r < t.size(); ++r)
+                {
+                    if (r == leave || t[r][entering] == 0)
+                        continue;
+                    const double f = t[r][entering];
+                    for (size_t k = 0; k <= m + n; ++k)
+                        t[r][k] -= f * t[leave][k];
+                }
+                const auto left = basis[leave];
+                basis[leave] = entering;
+                return left;
+            };
+
+            // the path starts in the tableau where the dropped label is not basic, then the label which leaves
+            // one tableau enters the other
+            size_t entering = dropped;
+            bool in_first = dropped < m;
+            const size_t max_pivots = 100 * (m + n) * (m + n);
+            for (size_t step = 0; step < max_pivots; ++step, in_first = !in_first)
+            {
+                const auto left = in_first
+                    ? pivot(first, first_basis, entering, m, n)
+                    : pivot(second, second_basis, entering, 0, m);
+                if (left == m + n)
+                    break;
+                if (left == dropped)
+                {
+                    auto normalized = [](const tableau& t, const std::vector<size_t>& basis, const size_t begin, const size_t end, const std::vector<size_t>& strategies)
+                    {
+                        mixed_strategy strategy;
+                        double total = 0;
+                        for (size_t r = 0; r < basis.size(); ++r)
+                            if (basis[r] >= begin && basis[r] < end)
+                                total += std::max(t[r].back(), 0.0);
+                        double sum = 0;
+                        for (size_t r = 0; r < basis.size(); ++r)
+                            if (basis[r] >= begin && basis[r] < end && t[r].back() > 1e-9 * total)
+                            {
+                                strategy.emplace_back(strategies[basis[r] - begin], t[r].back());
+                                sum += t[r].back();
+                            }
+                        for (auto& s : strategy)
+                            s.second /= sum;
+                        std::sort(strategy.begin(), strategy.end());
+                        return strategy;
+                    };
+                    return { normalized(first, first_basis, 0, m, rows), normalized(second, second_basis, m, m + n, columns) };
+                }
+                entering = left;
+            }
+            return {};
+        }
+
+        /*
+         * equilibria of the game, start is the strategy both players begin with;
+         * equilibria found in the restricted game at the end are checked against every strategy
+         */
+        template<typename Evaluate, typename Bound>
+        std::vector<result> search(lazy_game<Evaluate, Bound>& game, const size_t start, const size_t max_support)
+        {
+            const size_t n = game.size();
+            auto times_first = [&game](const size_t i, const size_t j) { return game(i, j).first.mean; };
+            auto times_second = [&game](const size_t i, const size_t j) { return game(i, j).second.mean; };
+            auto column_player_times = [&game](const size_t j, const size_t i) { return game(i, j).second.mean; };
+
+            std::vector<size_t> all(n);
+            std::iota(all.begin(), all.end(), 0);
+
+            std::vector<size_t> rows{ start }, columns{ start };
+            game.require_row(start);
+            game.require_column(start);
+
+            for (;;)
+            {
+                auto reduced_rows = rows, reduced_columns = columns;
+                detail::remove_dominated(reduced_rows, reduced_columns, times_first, times_second);
+                const auto restricted = lemke_howson(reduced_rows, reduced_columns, times_first, times_second, 0);
+                if (restricted.first.empty())
+                    return std::vector<result>();
+
+                const auto& first = restricted.first;
+                const auto& second = restricted.second;
+                auto best = [](const std::vector<size_t>& strategies, const mixed_strategy& opponent, auto times)
+                {
+                    size_t best_strategy = strategies.front();
+                    double best_time = std::numeric_limits<double>::max();
+                    for (auto s : strategies)
+                    {
+                        const double t = detail::expected(s, opponent, times);
+                        if (t < best_time)
+                        {
+                            best_time = t;
+                            best_strategy = s;
+                        }
+                    }
+                    return best_strategy;
+                };
+
+                bool grown = false;
+                if (!detail::is_best_response(first, second, all, times_first))
+                {
+                    const auto r = best(all, second, times_first);
+                    if (std::find(rows.begin(), rows.end(), r) == rows.end())
+                    {
+                        rows.push_back(r);
+                        game.require_row(r);
+                        grown = true;
+                    }
+                }
+                if (!detail::is_best_response(second, first, all, column_player_times))
+                {
+                    const auto c = best(all, first, column_player_times);
+                    if (std::find(columns.begin(), columns.end(), c) == columns.end())
+                    {
+                        columns.push_back(c);
+                        game.require_column(c);
+                        grown = true;
+                    }
+                }
+                if (!grown)
+                    break;
+            }
+
+            // equilibria with small supports and the ones at the ends of Lemke-Howson paths of every label
+            auto candidates = support_enumeration(rows, columns, times_first, times_second, max_support);
+            detail::remove_dominated(rows, columns, times_first, times_second);
+            for (size_t label = 0; label < rows.size() + columns.size(); ++label)
+            {
+                auto candidate = lemke_howson(rows, columns, times_first, times_second, label);
+                if (!candidate.first.empty())
+                    candidates.push_back(std::move(candidate));
+            }
+
+            std::vector<result> results;
+            for (size_t k = 0; k < candidates.size(); ++k)
+            {
+                const auto& first = candidates[k].first;
+                const auto& second = candidates[k].second;
+                auto same = [&first, &second](const std::pair<mixed_strategy, mixed_strategy>& other)
+                {
+                    return detail::same_strategy(first, other.first) && detail::same_strategy(second, other.second);
+                };
+                if (std::any_of(candidates.begin(), candidates.begin() + k, same))
+                    continue;
+                if (!detail::is_best_response(first, second, all, times_first) || !detail::is_best_response(second, first, all, column_player_times))
+                    continue;
+
+                result r;
+                r.first = first;
+                r.second = second;
+                std::vector<std::pair<double, const estimate*>> value_first, value_second;
+                for (auto& f : first)
+                    for (auto& s : second)
+                    {
+                        const auto& c = game(f.first, s.first);
+                        value_first.emplace_back(f.second * s.second, &c.first);
+                        value_second.emplace_back(f.second * s.second, &c.second);
+                    }
+                r.time_first = detail::combine(value_first);
+                r.time_second = detail::combine(value_second);
+
+                // deviations within the support don't change the time, the gain of deviating to s is the value less
+                // the time of s, with the interval of the difference, which is narrower when cells share random numbers
+                auto max_gain = [](const std::vector<std::pair<double, const estimate*>>& value, const std::vector<size_t>& strategies,
+                    const mixed_strategy& own, const mixed_strategy& opponent, auto cell_of)
+                {
+                    double gain = -std::numeric_limits<double>::infinity();
+                    for (auto s : strategies)
+                    {
+                        if (std::any_of(own.begin(), own.end(), [s](const std::pair<size_t, double>& o) { return o.first == s; }))
+                            continue;
+                        auto terms = value;
+                        for (auto& o : opponent)
+                            terms.emplace_back(-o.second, &cell_of(s, o.first));
+                        const auto difference = detail::combine(terms);
+                        gain = std::max(gain, difference.mean - difference.half_width);
+                    }
+                    return gain;
+                };
+                r.max_gain_first = max_gain(value_first, all, first, second, [&game](const size_t i, const size_t j) -> const estimate& { return game(i, j).first; });
+                r.max_gain_second = max_gain(value_second, all, second, first, [&game](const size_t j, const size_t i) -> const estimate& { return game(i, j).second; });
+                results.push_back(std::move(r));
+            }
+            return results;
+        }
+    }
+}
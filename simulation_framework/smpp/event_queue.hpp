@@ -0,0 +1,410 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <smpp/priority_queue.hpp>
+
+/*
+ * Queues with the same interface as smpp::priority_queue, specialised for event simulation:
+ * time of every pushed event is not less than time of the last popped one (monotone queue).
+ * radix_heap and calendar_queue order by event_time(value), earliest first, and ignore Compare;
+ * tournament_tree uses Compare in the same way as smpp::priority_queue.
+ */
+namespace smpp
+{
+    namespace detail
+    {
+        inline size_t bit_width(const uint64_t value)
+        {
+            if (value == 0)
+                return 0;
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return index + 1;
+#else
+            return 64 - __builtin_clzll(value);
+#endif
+        }
+
+        // order of non negative doubles is the same as order of their bit patterns
+        inline uint64_t time_key(const double time)
+        {
+            uint64_t key;
+            std::memcpy(&key, &time, sizeof(key));
+            return key;
+        }
+    }
+
+    template <typename Type, typename Compare>
+    class radix_heap
+    {
+    public:
+        typedef Type										value_type;
+        typedef std::vector<std::pair<uint64_t, Type>>		bucket_type;
+        typedef Compare										value_compare;
+        typedef typename bucket_type::size_type				size_type;
+        typedef const Type&									const_reference;
+
+        explicit radix_heap(const Compare& = Compare())
+        { }
+
+        void push(value_type element)
+        {
+            const auto key = detail::time_key(event_time(element));
+            buckets[bucket_index(key)].emplace_back(key, std::move(element));
+            ++count;
+        }
+
+        template<typename... Args>
+        void emplace(Args... args)
+        {
+            push(value_type(std::forward<Args>(args)...));
+        }
+
+        value_type pop()
+        {
+            refill();
+            value_type result = std::move(buckets[0].back().second);
+            buckets[0].pop_back();
+            --count;
+            return result;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        const_reference top() const
+        {
+            refill();
+            return buckets[0].back().second;
+        }
+
+        void clear()
+        {
+            for (auto& bucket : buckets)
+                bucket.clear();
+            last = 0;
+            count = 0;
+        }
+
+    private:
+        size_t bucket_index(const uint64_t key) const
+        {
+            return detail::bit_width(key ^ last);
+        }
+
+        void refill() const
+        {
+            if (!buckets[0].empty())
+                return;
+
+            size_t i = 1;
+            while (buckets[i].empty())
+                ++i;
+
+            auto& bucket = buckets[i];
+            last = std::min_element(bucket.begin(), bucket.end(),
+                [](auto& l, auto& r) { return l.first < r.first; })->first;
+            for (auto& element : bucket)
+                buckets[bucket_index(element.first)].push_back(std::move(element));
+            bucket.clear();
+        }
+
+        mutable std::array<bucket_type, 65>	buckets;
+        mutable uint64_t					last	= 0;
+        size_type							count	= 0;
+    };
+
+    /*
+     * winner tree over fixed set of slots; pop followed by push reuses the popped slot with one replay
+     */
+    template <typename Type, typename Compare = std::less<Type>>
+    class tournament_tree
+    {
+    public:
+        typedef Type										value_type;
+        typedef std::vector<std::optional<Type>>			container_type;
+        typedef Compare										value_compare;
+        typedef typename container_type::size_type			size_type;
+        typedef const Type&									const_reference;
+
+        explicit tournament_tree(const Compare& compare = Compare())
+            : comparator{ compare }
+        { }
+
+        void push(value_type element)
+        {
+            size_type slot = vacated;
+            vacated = npos;
+            if (slot == npos)
+            {
+                if (free_slots.empty())
+                    grow();
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            slots[slot] = std::move(element);
+            replay(slot);
+            ++count;
+        }
+
+        template<typename... Args>
+        void emplace(Args... args)
+        {
+            push(value_type(std::forward<Args>(args)...));
+        }
+
+        value_type pop()
+        {
+            settle();
+            const auto slot = winners[1];
+            value_type result = std::move(*slots[slot]);
+            slots[slot].reset();
+            vacated = slot;
+            --count;
+            return result;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        const_reference top() const
+        {
+            settle();
+            return *slots[winners[1]];
+        }
+
+        void clear()
+        {
+            for (auto& slot : slots)
+                slot.reset();
+            free_slots.clear();
+            for (auto i = slots.size(); i != 0; --i)
+                free_slots.push_back(i - 1);
+            vacated = npos;
+            count = 0;
+        }
+
+    private:
+        static constexpr size_type npos = ~size_type(0);
+
+        size_type better(const size_type l, const size_type r) const
+        {
+            if (!slots[l])
+                return r;
+            if (!slots[r])
+                return l;
+            return comparator(*slots[l], *slots[r]) ? r : l;
+        }
+
+        void replay(const size_type slot) const
+        {
+            for (auto node = (slots.size() + slot) / 2; node != 0; node /= 2)
+                winners[node] = better(winners[2 * node], winners[2 * node + 1]);
+        }
+
+        void settle() const
+        {
+            if (vacated == npos)
+                return;
+            free_slots.push_back(vacated);
+            replay(vacated);
+            vacated = npos;
+        }
+
+        void grow()
+        {
+            const auto old_size = slots.size();
+            const auto new_size = old_size == 0 ? 1 : 2 * old_size;
+            slots.resize(new_size);
+            winners.assign(2 * new_size, 0);
+            for (size_type i = 0; i < new_size; ++i)
+                winners[new_size + i] = i;
+            for (auto node = new_size - 1; node != 0; --node)
+                winners[node] = better(winners[2 * node], winners[2 * node + 1]);
+            for (auto i = new_size; i != old_size; --i)
+                free_slots.push_back(i - 1);
+        }
+
+        container_type					slots;
+        mutable std::vector<size_type>	winners = std::vector<size_type>(2, 0);
+        mutable std::vector<size_type>	free_slots;
+        mutable size_type				vacated = npos;
+        size_type						count	= 0;
+        mutable value_compare			comparator;
+    };
+
+    /*
+     * R. Brown's calendar queue: events are hashed into day buckets by time, the year is rescanned day by day
+     */
+    template <typename Type, typename Compare>
+    class calendar_queue
+    {
+    public:
+        typedef Type										value_type;
+        typedef std::vector<Type>							bucket_type;
+        typedef Compare										value_compare;
+        typedef typename bucket_type::size_type				size_type;
+        typedef const Type&									const_reference;
+
+        explicit calendar_queue(const Compare& = Compare())
+            : buckets(2)
+        { }
+
+        void push(value_type element)
+        {
+            insert(std::move(element));
+            if (++count > 2 * buckets.size())
+                resize(2 * buckets.size());
+        }
+
+        template<typename... Args>
+        void emplace(Args... args)
+        {
+            push(value_type(std::forward<Args>(args)...));
+        }
+
+        value_type pop()
+        {
+            auto& bucket = buckets[locate()];
+            value_type result = std::move(bucket.back());
+            bucket.pop_back();
+            last = event_time(result);
+            if (--count < buckets.size() / 4 && buckets.size() > 2)
+                resize(buckets.size() / 2);
+            return result;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        const_reference top() const
+        {
+            return buckets[locate()].back();
+        }
+
+        void clear()
+        {
+            for (auto& bucket : buckets)
+                bucket.clear();
+            last = 0.0;
+            count = 0;
+            start_year(last);
+        }
+
+    private:
+        size_type day(const double time) const
+        {
+            return static_cast<size_type>(std::fmod(std::floor(time / width), double(buckets.size())));
+        }
+
+        // buckets are sorted with the earliest event at the back
+        void insert(value_type element)
+        {
+            auto& bucket = buckets[day(event_time(element))];
+            auto position = std::upper_bound(bucket.begin(), bucket.end(), event_time(element),
+                [](const double time, const value_type& value) { return time > event_time(value); });
+            bucket.insert(position, std::move(element));
+        }
+
+        void start_year(const double time) const
+        {
+            current_day	= std::floor(time / width);
+            current		= day(time);
+        }
+
+        size_type locate() const
+        {
+            for (size_type i = 0; i < buckets.size(); ++i)
+            {
+                auto& bucket = buckets[current];
+                if (!bucket.empty() && std::floor(event_time(bucket.back()) / width) <= current_day)
+                    return current;
+                current = (current + 1) % buckets.size();
+                current_day += 1.0;
+            }
+
+            // nothing in this year, jump directly to the earliest event
+            size_type earliest = buckets.size();
+            for (size_type i = 0; i < buckets.size(); ++i)
+                if (!buckets[i].empty() && (earliest == buckets.size() || event_time(buckets[i].back()) < event_time(buckets[earliest].back())))
+                    earliest = i;
+            start_year(event_time(buckets[earliest].back()));
+            return earliest;
+        }
+
+        void resize(const size_type n_buckets)
+        {
+            std::vector<bucket_type> old(n_buckets);
+            std::swap(old, buckets);
+
+            double first = 0.0, latest = 0.0;
+            bool any = false;
+            for (auto& bucket : old)
+                if (!bucket.empty())
+                {
+                    first	= any ? std::min(first, event_time(bucket.back())) : event_time(bucket.back());
+                    latest	= any ? std::max(latest, event_time(bucket.front())) : event_time(bucket.front());
+                    any		= true;
+                }
+            if (any && latest > first)
+                width = 3.0 * (latest - first) / count;
+
+            for (auto& bucket : old)
+                for (auto& element : bucket)
+                    insert(std::move(element));
+            start_year(last);
+        }
+
+        std::vector<bucket_type>	buckets;
+        double						width	= 1.0;
+        double						last	= 0.0;
+        mutable size_type			current		= 0;
+        mutable double				current_day	= 0.0;
+        size_type					count	= 0;
+    };
+
+    /*
+     * queue policies for the task processors
+     */
+    struct binary_heap_queue
+    {
+        template<typename Type, typename Compare>
+        using type = priority_queue<Type, Compare>;
+    };
+
+    struct radix_heap_queue
+    {
+        template<typename Type, typename Compare>
+        using type = radix_heap<Type, Compare>;
+    };
+
+    struct tournament_tree_queue
+    {
+        template<typename Type, typename Compare>
+        using type = tournament_tree<Type, Compare>;
+    };
+
+    struct calendar_queue_queue
+    {
+        template<typename Type, typename Compare>
+        using type = calendar_queue<Type, Compare>;
+    };
+}
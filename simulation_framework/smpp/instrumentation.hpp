@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
+
+/*
+ * Phase timers and counters of simulations, compiled in only with SMPP_INSTRUMENTATION defined.
+ * Without it every call below is an empty inline function.
+ *
+ * Every thread accumulates into its own record, report sums the records of all threads.
+ * Allocations are counted by replacement operator new/delete, SMPP_INSTRUMENTATION_ALLOCATION_HOOKS
+ * has to be put at namespace scope of exactly one translation unit.
+ */
+namespace smpp
+{
+    namespace instrumentation
+    {
+        enum class phase
+        {
+            create_tasks,
+            shuffle,
+            sort_tasks,
+            sort_procs,
+            analytic,
+            engine,
+            reduction,
+            count
+        };
+
+        enum class counter
+        {
+            queue_push,
+            queue_pop,
+            allocations,
+            bytes_allocated,
+            bytes_touched,	// size of the buffers walked by a phase
+            count
+        };
+
+#ifdef SMPP_INSTRUMENTATION
+        namespace detail
+        {
+            struct thread_record
+            {
+                std::array<double, size_t(phase::count)>		seconds{};
+                std::array<uint64_t, size_t(phase::count)>		calls{};
+                std::array<uint64_t, size_t(counter::count)>	counts{};
+            };
+
+            struct registry
+            {
+                thread_record* add()
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    records.push_back(std::make_unique<thread_record>());
+                    return records.back().get();
+                }
+
+                std::mutex									mutex;
+                std::vector<std::unique_ptr<thread_record>>	records;
+            };
+
+            inline registry& get_registry()
+            {
+                static registry r;
+                return r;
+            }
+
+            // records outlive their threads, they are owned by the registry
+            inline thread_record& current()
+            {
+                thread_local thread_record* record = get_registry().add();
+                return *record;
+            }
+
+            // allocations made while a record is being created are not counted
+            inline bool& in_hook()
+            {
+                thread_local bool value = false;
+                return value;
+            }
+        }
+
+        inline void count(const counter c, const uint64_t n = 1)
+        {
+            detail::current().counts[size_t(c)] += n;
+        }
+
+        // called through a pointer, so compilers don't pair inlined operator new with free
+        inline void release(void* p)
+        {
+            static void (* volatile free_function)(void*) = std::free;
+            free_function(p);
+        }
+
+        inline void count_allocation(const size_t bytes)
+        {
+            auto& busy = detail::in_hook();
+            if (busy)
+                return;
+            busy = true;
+            auto& record = detail::current();
+            ++record.counts[size_t(counter::allocations)];
+            record.counts[size_t(counter::bytes_allocated)] += bytes;
+            busy = false;
+        }
+
+        class scoped_phase
+        {
+        public:
+            explicit scoped_phase(const phase p)
+                : p(p), start(std::chrono::steady_clock::now())
+            {
+
+            }
+
+            scoped_phase(const scoped_phase&) = delete;
+            scoped_phase& operator=(const scoped_phase&) = delete;
+
+            ~scoped_phase()
+            {
+                auto& record = detail::current();
+                record.seconds[size_t(p)] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                ++record.calls[size_t(p)];
+            }
+
+        private:
+            phase									p;
+            std::chrono::steady_clock::time_point	start;
+        };
+
+        inline void report(std::ostream& stream)
+        {
+            static const char* phase_names[] = { "create_tasks", "shuffle", "sort_tasks", "sort_procs", "analytic", "engine", "reduction" };
+            static const char* counter_names[] = { "queue_push", "queue_pop", "allocations", "bytes_allocated", "bytes_touched" };
+
+            detail::thread_record total;
+            {
+                auto& r = detail::get_registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (auto& record : r.records)
+                {
+                    for (size_t i = 0; i < total.seconds.size(); ++i)
+                    {
+                        total.seconds[i] += record->seconds[i];
+                        total.calls[i] += record->calls[i];
+                    }
+                    for (size_t i = 0; i < total.counts.size(); ++i)
+                        total.counts[i] += record->counts[i];
+                }
+            }
+
+            double all_seconds = 0;
+            for (auto s : total.seconds)
+                all_seconds += s;
+
+            const auto flags = stream.flags();
+            const auto precision = stream.precision();
+            stream << std::fixed << std::setprecision(6);
+            stream << "phase,calls,seconds,share,mean_us" << std::endl;
+            for (size_t i = 0; i < total.seconds.size(); ++i)
+            {
+                stream << phase_names[i] << ',' << total.calls[i] << ',' << total.seconds[i] << ',';
+                stream << (all_seconds > 0 ? total.seconds[i] / all_seconds : 0.0) << ',';
+                stream << (total.calls[i] != 0 ? total.seconds[i] * 1e6 / total.calls[i] : 0.0) << std::endl;
+            }
+            stream << "counter,value" << std::endl;
+            for (size_t i = 0; i < total.counts.size(); ++i)
+                stream << counter_names[i] << ',' << total.counts[i] << std::endl;
+            stream.flags(flags);
+            stream.precision(precision);
+        }
+#else
+        inline void count(const counter, const uint64_t = 1)
+        {
+
+        }
+
+        class scoped_phase
+        {
+        public:
+            explicit scoped_phase(const phase)
+            {
+
+            }
+        };
+
+        inline void report(std::ostream&)
+        {
+
+        }
+#endif
+    }
+}
+
+#ifdef SMPP_INSTRUMENTATION
+#define SMPP_INSTRUMENTATION_ALLOCATION_HOOKS													\
+    void* operator new(std::size_t size)														\
+    {																							\
+        smpp::instrumentation::count_allocation(size);											\
+        if (void* p = std::malloc(size == 0 ? 1 : size))										\
+            return p;																			\
+        throw std::bad_alloc();																	\
+    }																							\
+    void operator delete(void* p) noexcept														\
+    {																							\
+        smpp::instrumentation::release(p);														\
+    }																							\
+    void operator delete(void* p, std::size_t) noexcept											\
+    {																							\
+        smpp::instrumentation::release(p);														\
+    }
+#else
+#define SMPP_INSTRUMENTATION_ALLOCATION_HOOKS
+#endif
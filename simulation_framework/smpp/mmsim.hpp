@@ -2,6 +2,12 @@
 #include<list>
 #include<vector>
 #include<tuple>
+#include<valarray>
+#include<limits>
+#include<algorithm>
+
+#include <smpp/processor.hpp>
+#include <smpp/task_run.hpp>
 
 
 namespace smpp
@@ -51,29 +57,114 @@ namespace smpp
          * Task should have static create method (double complexity, size_t n_numbers, size_t userid)
          */
         template<typename Task>
-        std::vector<Task> create_tasks(const size_t problem_size, const std::list<size_t>& slice_sizes)
+        std::vector<task_run<Task>> create_task_runs(const size_t problem_size, const std::list<size_t>& slice_sizes)
         {
             typedef decltype(calculate_complexity(size_t(), size_t(), size_t(), double())) compl_t;
 
-            const auto n_tasks = calculate_number_of_tasks(problem_size, slice_sizes);
-            std::vector<Task> tasks;
-            tasks.reserve(n_tasks);
+            std::vector<task_run<Task>> runs;
+            runs.reserve(3 * slice_sizes.size());
             typename Task::userid_type user_id = 0;
             for (auto& slice_size : slice_sizes)
             {
                 size_t n;
                 compl_t p1, p2, p3;
                 std::tie(n, p1, p2, p3) = calculate_complexities(problem_size, slice_size);
-                tasks.insert(tasks.end(), n*n, Task::create(p1.first, p1.second, user_id));
+                runs.emplace_back(Task::create(p1.first, p1.second, user_id), n*n);
                 if (p2.first != 0.0)
                 {
-                    tasks.insert(tasks.end(), 2 * n, Task::create(p2.first, p2.second, user_id));
-                    tasks.insert(tasks.end(), 1, Task::create(p3.first, p3.second, user_id));
+                    runs.emplace_back(Task::create(p2.first, p2.second, user_id), 2 * n);
+                    runs.emplace_back(Task::create(p3.first, p3.second, user_id), 1);
                 }
                 ++user_id;
             }
 
-            return tasks;
+            return runs;
+        }
+
+        struct time_bounds
+        {
+            std::valarray<double>	lower;
+            std::valarray<double>	upper;
+        };
+
+        /*
+         * Bounds of the completion time of every user which hold for any order of tasks and processors,
+         * for engines which give the next task to the processor which is free first.
+         *
+         * d(p, t) is the time of task t on processor p, any weights w(p) > 0 give
+         * lower:   every task of the user ends by its time T, so sum over p of w(p) * (busy time of p on its tasks) <= T * sum w,
+         *          T >= sum over its tasks of min_p w(p) d(p, t) / sum w, and T >= min_p d(p, t) of its longest task
+         * upper:   every processor is busy until the last task starts at s, so s * sum w <= sum over all tasks of max_p w(p) d(p, t),
+         *          and every user is done by s + max d(p, t)
+         * Weights are w(p) = 1 / d(p, t) of each kind of task, the best of them is taken.
+         */
+        template<typename Task, typename Engine>
+        time_bounds completion_time_bounds(const size_t problem_size, const std::list<size_t>& slice_sizes, const std::vector<Processor>& procs, const Engine& tprocessor)
+        {
+            const auto n_users = slice_sizes.size();
+            time_bounds bounds{ std::valarray<double>(0.0, n_users), std::valarray<double>(std::numeric_limits<double>::infinity(), n_users) };
+            if (procs.empty())
+                return bounds;
+
+            auto runs = create_task_runs<Task>(problem_size, slice_sizes);
+            runs.erase(std::remove_if(runs.begin(), runs.end(), [](const task_run<Task>& r) { return r.count == 0; }), runs.end());
+
+            // durations[k * n_procs + p]
+            const auto n_procs = procs.size();
+            std::vector<double> durations(runs.size() * n_procs);
+            double longest = 0;
+            for (size_t k = 0; k < runs.size(); ++k)
+                for (size_t p = 0; p < n_procs; ++p)
+                {
+                    durations[k * n_procs + p] = tprocessor.time_to_process(procs[p], runs[k].task);
+                    longest = std::max(longest, durations[k * n_procs + p]);
+                }
+
+            std::valarray<double> work(n_users);
+            double makespan_work = std::numeric_limits<double>::infinity();
+            for (size_t w = 0; w < runs.size(); ++w)
+            {
+                const double* weight_of = &durations[w * n_procs];
+                double weights = 0;
+                for (size_t p = 0; p < n_procs; ++p)
+                    weights += 1 / weight_of[p];
+
+                work = 0;
+                double all_work = 0;
+                for (size_t k = 0; k < runs.size(); ++k)
+                {
+                    double least = std::numeric_limits<double>::infinity(), most = 0;
+                    for (size_t p = 0; p < n_procs; ++p)
+                    {
+                        const double weighted = durations[k * n_procs + p] / weight_of[p];
+                        least = std::min(least, weighted);
+                        most = std::max(most, weighted);
+                    }
+                    work[runs[k].task.userid] += runs[k].count * least;
+                    all_work += runs[k].count * most;
+                }
+                for (size_t u = 0; u < n_users; ++u)
+                    bounds.lower[u] = std::max(bounds.lower[u], work[u] / weights);
+                makespan_work = std::min(makespan_work, all_work / weights);
+            }
+
+            for (size_t k = 0; k < runs.size(); ++k)
+            {
+                const auto begin = durations.begin() + k * n_procs;
+                auto& lower = bounds.lower[runs[k].task.userid];
+                lower = std::max(lower, *std::min_element(begin, begin + n_procs));
+            }
+            bounds.upper = runs.empty() ? 0.0 : makespan_work + longest;
+            return bounds;
+        }
+
+        /*
+         * Task should have static create method (double complexity, size_t n_numbers, size_t userid)
+         */
+        template<typename Task>
+        std::vector<Task> create_tasks(const size_t problem_size, const std::list<size_t>& slice_sizes)
+        {
+            return expand_task_runs(create_task_runs<Task>(problem_size, slice_sizes));
         }
     }
 }
\ No newline at end of file
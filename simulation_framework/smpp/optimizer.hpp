@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+ * Minimum of a function of strategy index 0..n-1 which is mostly unimodal with some jumps, e.g. the single
+ * player completion time over sorted slice sizes, with few evaluations.
+ *
+ * A coarse grid is evaluated first. Every local minimum of the grid among the best n_candidates points gives
+ * a bracket between its grid neighbours, which is narrowed by golden section search on integers and scanned
+ * when it's a few points wide. Neighbours of the best point are checked at the end and the search moves
+ * while they are better, so a jump next to the optimum is not missed.
+ * With bounds, points which provably can't be the minimum are compared by their lower bounds and never evaluated.
+ */
+namespace smpp
+{
+    namespace optimizer
+    {
+        // no bounds, every point is evaluated
+        struct unbounded
+        {
+            std::pair<double, double> operator()(size_t) const
+            {
+                return { 0.0, std::numeric_limits<double>::infinity() };
+            }
+        };
+
+        /*
+         * values of a function which are computed on demand and kept;
+         * Evaluate(const std::vector<size_t>&) returns std::vector<double> of the given indices, so a batch can be done in parallel
+         * Bound(size_t) returns a lower and an upper bound of a value, a point whose lower bound is above the upper bound of
+         * another point requested so far or above a value found can't be the minimum and isn't evaluated, its lower bound is used instead
+         */
+        template<typename Evaluate, typename Bound = unbounded>
+        class lazy_curve
+        {
+        public:
+            lazy_curve(const size_t n, Evaluate evaluate, Bound bound = Bound())
+                : n(n), evaluate(std::move(evaluate)), bound(std::move(bound))
+            {
+
+            }
+
+            size_t size() const
+            {
+                return n;
+            }
+
+            void require(const std::vector<size_t>& indices)
+            {
+                std::vector<size_t> missing;
+                std::vector<std::pair<double, double>> bounds;
+                for (auto i : indices)
+                    if (i < n && known.count(i) == 0 && bounded.count(i) == 0 && std::find(missing.begin(), missing.end(), i) == missing.end())
+                    {
+                        missing.push_back(i);
+                        bounds.push_back(bound(i));
+                        incumbent = std::min(incumbent, bounds.back().second);
+                    }
+
+                std::vector<size_t> needed;
+                for (size_t k = 0; k < missing.size(); ++k)
+                    if (bounds[k].first > incumbent)
+                        bounded[missing[k]] = bounds[k].first;
+                    else
+                        needed.push_back(missing[k]);
+                if (needed.empty())
+                    return;
+                const auto values = evaluate(needed);
+                for (size_t k = 0; k < needed.size(); ++k)
+                {
+                    known[needed[k]] = values[k];
+                    incumbent = std::min(incumbent, values[k]);
+                }
+            }
+
+            double operator()(const size_t i)
+            {
+                require({ i });
+                const auto it = known.find(i);
+                return it != known.end() ? it->second : bounded.at(i);
+            }
+
+            // evaluated points by index
+            const std::map<size_t, double>& explored() const
+            {
+                return known;
+            }
+
+            // number of points which were ruled out by their bounds
+            size_t n_bounded() const
+            {
+                return bounded.size();
+            }
+
+        private:
+            size_t						n;
+            Evaluate					evaluate;
+            Bound						bound;
+            std::map<size_t, double>	known;
+            std::map<size_t, double>	bounded;
+            double						incumbent	= std::numeric_limits<double>::infinity();
+        };
+
+        // minimum of f on [a, b] by golden section, the last few points are scanned
+        template<typename Curve>
+        size_t golden_section(Curve& f, size_t a, size_t b)
+        {
+            const double inverse_phi = (std::sqrt(5.0) - 1) / 2;
+            while (b - a > 3)
+            {
+                const auto step = size_t(std::lround((b - a) * inverse_phi));
+                size_t c = b - step, d = a + step;
+                if (c >= d)
+                    c = d - 1;
+                f.require({ c, d });
+                if (f(c) <= f(d))
+                    b = d;
+                else
+                    a = c;
+            }
+            std::vector<size_t> rest;
+            for (size_t i = a; i <= b; ++i)
+                rest.push_back(i);
+            f.require(rest);
+            size_t best = a;
+            for (auto i : rest)
+                if (f(i) < f(best))
+                    best = i;
+            return best;
+        }
+
+        // index of the smallest value evaluated
+        template<typename Curve>
+        size_t minimize(Curve& f, const size_t coarse_points = 32, const size_t n_candidates = 3)
+        {
+            const size_t n = f.size();
+            if (n == 0)
+                return 0;
+
+            // rounded up, so the grid has at most coarse_points points
+            const size_t intervals = std::max<size_t>(1, coarse_points - 1);
+            const size_t stride = std::max<size_t>(1, (n - 1 + intervals - 1) / intervals);
+            std::vector<size_t> grid;
+            for (size_t i = 0; i < n; i += stride)
+                grid.push_back(i);
+            if (grid.back() != n - 1)
+                grid.push_back(n - 1);
+            f.require(grid);
+
+            // local minima of the grid, best first
+            std::vector<size_t> minima;
+            for (size_t g = 0; g < grid.size(); ++g)
+                if ((g == 0 || f(grid[g]) <= f(grid[g - 1])) && (g + 1 == grid.size() || f(grid[g]) <= f(grid[g + 1])))
+                    minima.push_back(g);
+            std::sort(minima.begin(), minima.end(), [&](const size_t l, const size_t r) { return f(grid[l]) < f(grid[r]); });
+            if (minima.size() > n_candidates)
+                minima.resize(n_candidates);
+
+            size_t best = grid[minima.front()];
+            for (auto g : minima)
+            {
+                const auto a = grid[g == 0 ? 0 : g - 1];
+                const auto b = grid[g + 1 == grid.size() ? g : g + 1];
+                const auto candidate = golden_section(f, a, b);
+                if (f(candidate) < f(best))
+                    best = candidate;
+            }
+
+            for (;;)
+            {
+                f.require({ best == 0 ? 0 : best - 1, best + 1 });
+                size_t next = best;
+                if (best != 0 && f(best - 1) < f(next))
+                    next = best - 1;
+                if (best + 1 < n && f(best + 1) < f(next))
+                    next = best + 1;
+                if (next == best)
+                    break;
+                best = next;
+            }
+
+            // points ruled out by bounds were compared by their lower bounds, the result is the best evaluated one
+            const auto& explored = f.explored();
+            return std::min_element(explored.begin(), explored.end(),
+                [](const std::pair<const size_t, double>& l, const std::pair<const size_t, double>& r) { return l.second < r.second; })->first;
+        }
+    }
+}
@@ -50,6 +50,12 @@ namespace smpp
             return container.front();
         }
 
+        // keeps allocated storage
+        void clear()
+        {
+            container.clear();
+        }
+
     private:
         container_type	container;
         value_compare	comparator;
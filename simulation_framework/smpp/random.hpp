@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <utility>
+
+namespace smpp
+{
+    /*
+     * Counter based generator (Philox4x32-10, Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+     * n-th output of a stream is a function of (seed, stream, n) only, so streams for different
+     * coordinates are independent and cost nothing to create.
+     */
+    class random_stream
+    {
+    public:
+        typedef uint64_t result_type;
+
+        explicit random_stream(const uint64_t seed = 0, const uint64_t stream = 0)
+            : seed(seed), stream(stream)
+        {
+
+        }
+
+        static random_stream from_entropy()
+        {
+            std::random_device rd;
+            return random_stream((uint64_t(rd()) << 32) | rd());
+        }
+
+        // stream of the seed for given coordinates, e.g. (slice first, slice second, replicate)
+        template<typename Coordinates>
+        static random_stream for_coordinates(const uint64_t seed, const Coordinates& coordinates)
+        {
+            return random_stream(seed, hash(coordinates));
+        }
+
+        /*
+         * same numbers, but uniform_index gives n - 1 - i where this stream gives i, so every draw of a shuffle is mirrored;
+         * a replicate and its antithetic one are both uniform and negatively correlated
+         */
+        random_stream antithetic() const
+        {
+            random_stream r(seed, stream);
+            r.mirrored = !mirrored;
+            r.by_key = by_key;
+            return r;
+        }
+
+        bool is_antithetic() const
+        {
+            return mirrored;
+        }
+
+        /*
+         * same numbers, but shuffles order items by key(identity of the item) instead of drawing in sequence,
+         * so simulations sharing the stream give an item they share the same place among the items they share
+         */
+        random_stream keyed() const
+        {
+            random_stream r(seed, stream);
+            r.mirrored = mirrored;
+            r.by_key = true;
+            return r;
+        }
+
+        bool is_keyed() const
+        {
+            return by_key;
+        }
+
+        // draw of an item, e.g. (user, shape, rank), independent of other draws and the same for an antithetic stream,
+        // which mirrors the items the keys are given to instead
+        uint64_t key(std::initializer_list<uint64_t> identity) const
+        {
+            // sequential draws never reach the top half of counters
+            const auto block = philox(hash(identity) | (uint64_t(1) << 63));
+            return (uint64_t(block[1]) << 32) | block[0];
+        }
+
+        static constexpr result_type min()
+        {
+            return 0;
+        }
+
+        static constexpr result_type max()
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        result_type operator()()
+        {
+            if (has_spare)
+            {
+                has_spare = false;
+                return spare;
+            }
+            const auto block = philox(counter++);
+            spare = (uint64_t(block[3]) << 32) | block[2];
+            has_spare = true;
+            return (uint64_t(block[1]) << 32) | block[0];
+        }
+
+    private:
+        template<typename Coordinates>
+        static uint64_t hash(const Coordinates& coordinates)
+        {
+            uint64_t h = 0;
+            uint64_t n = 0;
+            for (auto c : coordinates)
+                h = mix(h ^ (c + 0x9E3779B97F4A7C15ull * ++n));
+            return h;
+        }
+
+        static uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        std::array<uint32_t, 4> philox(const uint64_t n) const
+        {
+            std::array<uint32_t, 4> x{ uint32_t(n), uint32_t(n >> 32), uint32_t(stream), uint32_t(stream >> 32) };
+            uint32_t k0 = uint32_t(seed), k1 = uint32_t(seed >> 32);
+            for (int round = 0; round < 10; ++round)
+            {
+                const uint64_t p0 = uint64_t(0xD2511F53u) * x[0];
+                const uint64_t p1 = uint64_t(0xCD9E8D57u) * x[2];
+                x = { uint32_t(p1 >> 32) ^ x[1] ^ k0, uint32_t(p1), uint32_t(p0 >> 32) ^ x[3] ^ k1, uint32_t(p0) };
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            return x;
+        }
+
+        uint64_t	seed;
+        uint64_t	stream;
+        uint64_t	counter		= 0;
+        uint64_t	spare		= 0;
+        bool		has_spare	= false;
+        bool		mirrored	= false;
+        bool		by_key		= false;
+    };
+
+    template<typename URNG>
+    bool is_antithetic(const URNG&)
+    {
+        return false;
+    }
+
+    inline bool is_antithetic(const random_stream& generator)
+    {
+        return generator.is_antithetic();
+    }
+
+    /*
+     * uniform integer in [0, n), unlike std::uniform_int_distribution gives the same numbers with every standard library
+     */
+    template<typename URNG>
+    uint64_t uniform_index(URNG& generator, const uint64_t n)
+    {
+        static_assert(URNG::min() == 0 && URNG::max() == std::numeric_limits<uint64_t>::max(), "64 bit generator is expected");
+        const uint64_t threshold = (0 - n) % n;
+        for (;;)
+        {
+            const uint64_t value = generator();
+            if (value >= threshold)
+                return is_antithetic(generator) ? n - 1 - value % n : value % n;
+        }
+    }
+
+    template<typename RandomIt, typename URNG>
+    void shuffle(RandomIt first, RandomIt last, URNG& generator)
+    {
+        const auto n = static_cast<uint64_t>(std::distance(first, last));
+        for (uint64_t i = n; i > 1; --i)
+        {
+            using std::swap;
+            swap(first[i - 1], first[uniform_index(generator, i)]);
+        }
+    }
+}
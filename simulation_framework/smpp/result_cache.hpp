@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <valarray>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+
+/*
+ * Results of simulations kept between runs, keyed by a fingerprint of everything the result depends on.
+ *
+ * file:        header, then capacity entries of which the first count are used, in order of insertion
+ * header:      "SMPPRC" format_version(u32) entry_size(u32) capacity(u64) count(u64)
+ * entry:       fingerprint(2 x u64) n_users(u32) reserved(u32) times(max_users x f64)
+ *
+ * The file is memory mapped and grows by doubling, values are in native byte order.
+ * An entry is written before count is increased, so an interrupted run loses at most the entry being written.
+ * One process at a time, the file is locked while it is open.
+ */
+namespace smpp
+{
+    // part of every fingerprint, has to be increased by changes which give other results for the same inputs
+    constexpr uint64_t simulation_version = 1;
+
+    /*
+     * 128 bit hash of a sequence of values, two independent 64 bit chains
+     */
+    class fingerprint
+    {
+    public:
+        struct key
+        {
+            bool operator==(const key& r) const
+            {
+                return high == r.high && low == r.low;
+            }
+
+            uint64_t	high;
+            uint64_t	low;
+        };
+
+        struct key_hash
+        {
+            size_t operator()(const key& k) const
+            {
+                return size_t(k.low);
+            }
+        };
+
+        fingerprint()
+        {
+            add(simulation_version);
+        }
+
+        fingerprint& add(const uint64_t value)
+        {
+            high = mix(high ^ value);
+            low = mix((low + value) * 0xD6E8FEB86659FD93ull);
+            return *this;
+        }
+
+        fingerprint& add(const double value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return add(bits);
+        }
+
+        fingerprint& add(const std::string& value)
+        {
+            add(uint64_t(value.size()));
+            for (auto c : value)
+                add(uint64_t(uint8_t(c)));
+            return *this;
+        }
+
+        template<typename Iterator>
+        fingerprint& add(Iterator begin, const Iterator end)
+        {
+            uint64_t n = 0;
+            for (; begin != end; ++begin, ++n)
+                add(*begin);
+            return add(n);
+        }
+
+        key value() const
+        {
+            return key{ high, low };
+        }
+
+    private:
+        static uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t	high	= 0x243F6A8885A308D3ull;
+        uint64_t	low		= 0x13198A2E03707344ull;
+    };
+
+    /*
+     * Persistent map from fingerprint to per user times, safe to use from several threads.
+     */
+    class result_cache
+    {
+    public:
+        static constexpr uint32_t	format_version	= 1;
+        static constexpr size_t		max_users		= 4;
+
+        explicit result_cache(const std::string& path, const uint64_t initial_capacity = 1 << 12)
+            : path(path)
+        {
+            namespace bip = boost::interprocess;
+            if (!std::filesystem::exists(path))
+            {
+                std::ofstream create(path, std::ios::binary);
+                if (!create.is_open())
+                    throw std::runtime_error("couldn't create cache file");
+                header h{};
+                std::memcpy(h.magic, magic, sizeof(h.magic));
+                h.format_version	= format_version;
+                h.entry_size		= sizeof(entry);
+                h.capacity			= initial_capacity;
+                create.write(reinterpret_cast<const char*>(&h), sizeof(h));
+                create.close();
+                std::filesystem::resize_file(path, file_size(initial_capacity));
+            }
+            else if (std::filesystem::file_size(path) < sizeof(header))
+            {
+                throw std::runtime_error("bad cache file");
+            }
+
+            lock = bip::file_lock(path.c_str());
+            if (!lock.try_lock())
+                throw std::runtime_error("cache file is used by another process");
+            map();
+
+            const auto& h = get_header();
+            if (std::memcmp(h.magic, magic, sizeof(h.magic)) != 0 || h.format_version != format_version || h.entry_size != sizeof(entry)
+                || h.count > h.capacity || std::filesystem::file_size(path) < file_size(h.capacity))
+                throw std::runtime_error("bad cache file");
+
+            index.reserve(h.count);
+            for (uint64_t i = 0; i < h.count; ++i)
+                index.emplace(entries()[i].id, i);
+        }
+
+        result_cache(const result_cache&) = delete;
+        result_cache& operator=(const result_cache&) = delete;
+
+        ~result_cache()
+        {
+            region.flush();
+        }
+
+        bool find(const fingerprint::key& id, std::valarray<double>& times) const
+        {
+            std::shared_lock<std::shared_mutex> guard(mutex);
+            auto it = index.find(id);
+            if (it == index.end())
+                return false;
+            const auto& e = entries()[it->second];
+            if (times.size() != e.n_users)
+                times.resize(e.n_users);
+            for (size_t u = 0; u < e.n_users; ++u)
+                times[u] = e.times[u];
+            return true;
+        }
+
+        // results of more than max_users users are not stored
+        void insert(const fingerprint::key& id, const std::valarray<double>& times)
+        {
+            if (times.size() > max_users)
+                return;
+            std::unique_lock<std::shared_mutex> guard(mutex);
+            if (index.count(id) != 0)
+                return;
+            if (get_header().count == get_header().capacity)
+                grow();
+
+            const auto i = get_header().count;
+            auto& e = entries()[i];
+            e.id		= id;
+            e.n_users	= uint32_t(times.size());
+            for (size_t u = 0; u < times.size(); ++u)
+                e.times[u] = times[u];
+            ++get_header().count;
+            index.emplace(id, i);
+        }
+
+        size_t size() const
+        {
+            std::shared_lock<std::shared_mutex> guard(mutex);
+            return index.size();
+        }
+
+    private:
+        static constexpr char magic[8] = "SMPPRC";
+
+        struct header
+        {
+            char		magic[8];
+            uint32_t	format_version;
+            uint32_t	entry_size;
+            uint64_t	capacity;
+            uint64_t	count;
+        };
+
+        struct entry
+        {
+            fingerprint::key	id;
+            uint32_t			n_users;
+            uint32_t			reserved;
+            double				times[max_users];
+        };
+
+        static uint64_t file_size(const uint64_t capacity)
+        {
+            return sizeof(header) + capacity * sizeof(entry);
+        }
+
+        void map()
+        {
+            namespace bip = boost::interprocess;
+            mapping = bip::file_mapping(path.c_str(), bip::read_write);
+            region = bip::mapped_region(mapping, bip::read_write);
+        }
+
+        void grow()
+        {
+            const auto capacity = get_header().capacity * 2;
+            region.flush();
+            region = boost::interprocess::mapped_region();
+            std::filesystem::resize_file(path, file_size(capacity));
+            map();
+            get_header().capacity = capacity;
+        }
+
+        header& get_header() const
+        {
+            return *static_cast<header*>(region.get_address());
+        }
+
+        entry* entries() const
+        {
+            return reinterpret_cast<entry*>(static_cast<char*>(region.get_address()) + sizeof(header));
+        }
+
+        std::string										path;
+        boost::interprocess::file_lock					lock;
+        boost::interprocess::file_mapping				mapping;
+        boost::interprocess::mapped_region				region;
+        std::unordered_map<fingerprint::key, uint64_t, fingerprint::key_hash>	index;
+        mutable std::shared_mutex						mutex;
+    };
+}
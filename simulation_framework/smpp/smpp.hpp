@@ -4,56 +4,294 @@
 #include <valarray>
 #include <list>
 #include <functional>
-#include <random>
-#include <set>
 
 #include <smpp/processor.hpp>
 #include <smpp/task.hpp>
 #include <smpp/priority_queue.hpp>
 #include <smpp/task_completition.hpp>
 #include <smpp/task_processor.hpp>
+#include <smpp/task_run.hpp>
+#include <smpp/task_run_processor.hpp>
+#include <smpp/analytic.hpp>
+#include <smpp/task_stream.hpp>
+#include <smpp/random.hpp>
+#include <smpp/workspace.hpp>
+#include <smpp/user_completion.hpp>
+#include <smpp/instrumentation.hpp>
 
 namespace smpp
 {
+    /*
+     * ProcOrder and TaskOrder are comparators of Processor and SimpleTask, Engine is a TaskProcessor
+     * concrete types let sorting and the engine loop be inlined, Processor::comparator, SimpleTask::comparator and
+     * TaskProcessor work as well
+     */
+    template<typename ProcOrder, typename TaskOrder, typename Engine>
     auto simulate(
-        std::vector<Processor> procs, Processor::comparator proc_comp,
-        std::vector<SimpleTask>& tasks, SimpleTask::comparator task_comp,
-        const TaskProcessor& tprocessor,
+        std::vector<Processor> procs, ProcOrder proc_comp,
+        std::vector<SimpleTask>& tasks, TaskOrder task_comp,
+        const Engine& tprocessor,
         const SimpleTask::userid_type n_user_hint,
         const bool shuffle = true,
-        const bool return_processed = false
+        const bool return_processed = false,
+        random_stream generator = random_stream::from_entropy()
     )
     {
+        using namespace instrumentation;
         auto& tasks_to_process = tasks;
+        const auto tasks_bytes = tasks_to_process.size() * sizeof(SimpleTask);
 
         if (shuffle)
         {
-            std::random_device rd;
-            std::mt19937 g(rd());
-            std::shuffle(tasks_to_process.begin(), tasks_to_process.end(), g);
+            scoped_phase timer(phase::shuffle);
+            smpp::shuffle(tasks_to_process.begin(), tasks_to_process.end(), generator);
+            count(counter::bytes_touched, tasks_bytes);
+        }
+        {
+            scoped_phase timer(phase::sort_tasks);
+            std::sort(tasks_to_process.begin(), tasks_to_process.end(), task_comp);
+            count(counter::bytes_touched, tasks_bytes);
+        }
+        {
+            scoped_phase timer(phase::sort_procs);
+            std::sort(procs.begin(), procs.end(), proc_comp);
         }
-        // sort tasks
-        std::sort(tasks_to_process.begin(), tasks_to_process.end(), task_comp);
-        // sort processors
-        std::sort(procs.begin(), procs.end(), proc_comp);
-
-        auto processed_tasks = tprocessor(procs, tasks_to_process);
 
-        std::set<SimpleTask::userid_type> idx;
         std::valarray<double> times(n_user_hint);
-
-        //size_t previous_idx = std::numeric_limits<size_t>::max();
-        for (auto curr = processed_tasks.crbegin(); curr != processed_tasks.crend(); ++curr)
+        // identical processors don't need the event loop
+        if (!return_processed && !procs.empty() && analytic::is_homogeneous(procs))
         {
-            auto curr_idx = curr->task->userid;
-            if (idx.insert(curr_idx).second)
+            scoped_phase timer(phase::analytic);
+            if (analytic::simulate(procs, tasks_to_process, tprocessor, times))
             {
-                times[curr_idx] = curr->time_end;
-                if (idx.size() == n_user_hint)
-                    break;
+                count(counter::bytes_touched, tasks_bytes);
+                return std::make_pair(std::move(times), TaskProcessor::return_type());
             }
         }
 
+        TaskProcessor::return_type processed_tasks;
+        {
+            scoped_phase timer(phase::engine);
+            processed_tasks = tprocessor(procs, tasks_to_process);
+            count(counter::bytes_touched, tasks_bytes + processed_tasks.size() * sizeof(processed_tasks.front()));
+        }
+
+        {
+            scoped_phase timer(phase::reduction);
+            user_completion users;
+            users.reset(n_user_hint);
+            for (auto& tc : processed_tasks)
+                users(tc);
+            times = users.times();
+        }
+
         return std::make_pair(std::move(times), return_processed ? std::move(processed_tasks) : TaskProcessor::return_type());
     }
-}
\ No newline at end of file
+
+    // orderings are default constructed, template parameters are in the order of the overload above
+    template<typename ProcOrder, typename TaskOrder, typename Engine>
+    auto simulate(
+        std::vector<Processor> procs,
+        std::vector<SimpleTask>& tasks,
+        const Engine& tprocessor,
+        const SimpleTask::userid_type n_user_hint,
+        const bool shuffle = true,
+        const bool return_processed = false,
+        random_stream generator = random_stream::from_entropy()
+    )
+    {
+        return simulate(std::move(procs), ProcOrder(), tasks, TaskOrder(), tprocessor, n_user_hint, shuffle, return_processed, generator);
+    }
+
+    /*
+     * same as simulate, but simulates the tasks loaded into the workspace and keeps every buffer in it,
+     * completions are left in workspace.completions when return_processed is true, otherwise they are not stored at all
+     * tasks are put in order by bucket_order in O(n) and then gathered, tied tasks are interleaved randomly when shuffle is true,
+     * by keys of the tasks with a keyed generator, and keep their creation order otherwise
+     */
+    template<typename ProcOrder, typename TaskOrder, typename Engine>
+    const std::valarray<double>& simulate(
+        SimulationWorkspace<Engine>& workspace,
+        const std::vector<Processor>& procs, ProcOrder proc_comp,
+        TaskOrder task_comp,
+        const Engine& tprocessor,
+        const SimpleTask::userid_type n_user_hint,
+        const bool shuffle = true,
+        const bool return_processed = false,
+        random_stream generator = random_stream::from_entropy()
+    )
+    {
+        using namespace instrumentation;
+        typedef task_columns::index_type index_type;
+        const auto& base_tasks = workspace.base_tasks;
+        auto& order = workspace.order;
+        auto& tasks = workspace.tasks;
+
+        {
+            scoped_phase timer(phase::sort_tasks);
+            workspace.ordering.bucket(base_tasks, task_comp, order);
+            count(counter::bytes_touched, order.size() * sizeof(index_type) + base_tasks.size() * sizeof(task_columns::class_type));
+        }
+        if (shuffle)
+        {
+            scoped_phase timer(phase::shuffle);
+            if (generator.is_keyed())
+                workspace.ordering.key_groups(base_tasks, generator, order);
+            else
+                workspace.ordering.shuffle_groups(generator, order);
+            count(counter::bytes_touched, order.size() * sizeof(index_type));
+        }
+        {
+            scoped_phase timer(phase::sort_tasks);
+            tasks.gather(base_tasks, order);
+            count(counter::bytes_touched, order.size() * sizeof(index_type) + 2 * tasks.size() * (sizeof(task_columns::class_type) + sizeof(SimpleTask::userid_type)));
+        }
+        auto& sorted_procs = workspace.load_processors(procs, proc_comp);
+
+        auto& times = workspace.reset_times(n_user_hint);
+        // identical processors don't need the event loop
+        if (!return_processed && !sorted_procs.empty() && analytic::is_homogeneous(sorted_procs))
+        {
+            scoped_phase timer(phase::analytic);
+            if (analytic::simulate(sorted_procs, tasks, tprocessor, times))
+            {
+                workspace.completions.clear();
+                return times;
+            }
+        }
+
+        auto& users = workspace.users;
+        {
+            scoped_phase timer(phase::reduction);
+            users.reset(n_user_hint);
+            for (auto user : tasks.userid)
+                users.expect(user, 1);
+        }
+
+        auto& completions = workspace.completions;
+        completions.clear();
+        {
+            scoped_phase timer(phase::engine);
+            if (return_processed)
+            {
+                completions.reserve(tasks.size());
+                tprocessor(sorted_procs, tasks, workspace.queue, workspace.durations, [&users, &tasks, &completions](const column_event& e)
+                {
+                    users.complete(tasks.userid[e.task], e.time_end);
+                    completions.push_back(e);
+                });
+            }
+            else
+            {
+                tprocessor(sorted_procs, tasks, workspace.queue, workspace.durations, [&users, &tasks](const column_event& e)
+                {
+                    users.complete(tasks.userid[e.task], e.time_end);
+                });
+            }
+        }
+
+        scoped_phase timer(phase::reduction);
+        times = users.times();
+        return times;
+    }
+
+    /*
+     * same as simulate, but tasks are generated lazily from runs in scheduling order,
+     * memory doesn't depend on the number of tasks
+     * every completed task_completition<SimpleTask> is folded into the user times and passed to on_complete,
+     * in order of completion, and isn't kept
+     */
+    template<typename ProcOrder, typename TaskOrder, typename Engine, typename OnComplete>
+    std::valarray<double> simulate_stream(
+        std::vector<Processor> procs, ProcOrder proc_comp,
+        std::vector<task_run<SimpleTask>> runs, TaskOrder task_comp,
+        const Engine& tprocessor,
+        const SimpleTask::userid_type n_user_hint,
+        const bool shuffle,
+        random_stream generator,
+        OnComplete&& on_complete
+    )
+    {
+        // sort processors
+        std::sort(procs.begin(), procs.end(), proc_comp);
+
+        user_completion users;
+        {
+            instrumentation::scoped_phase timer(instrumentation::phase::reduction);
+            users.reset(n_user_hint);
+            for (auto& r : runs)
+                users.expect(r.task.userid, r.count);
+        }
+
+        {
+            instrumentation::scoped_phase timer(instrumentation::phase::engine);
+            task_stream<SimpleTask, random_stream> stream(std::move(runs), task_comp, shuffle, generator);
+            tprocessor(procs, stream, [&users, &on_complete](const task_completition<SimpleTask>& tc)
+            {
+                users(tc);
+                on_complete(tc);
+            });
+        }
+
+        instrumentation::scoped_phase timer(instrumentation::phase::reduction);
+        return users.times();
+    }
+
+    template<typename ProcOrder, typename TaskOrder, typename Engine>
+    std::valarray<double> simulate_stream(
+        std::vector<Processor> procs, ProcOrder proc_comp,
+        std::vector<task_run<SimpleTask>> runs, TaskOrder task_comp,
+        const Engine& tprocessor,
+        const SimpleTask::userid_type n_user_hint,
+        const bool shuffle = true,
+        random_stream generator = random_stream::from_entropy()
+    )
+    {
+        return simulate_stream(std::move(procs), proc_comp, std::move(runs), task_comp, tprocessor, n_user_hint, shuffle, generator, [](const task_completition<SimpleTask>&) {});
+    }
+
+    /*
+     * same as simulate, but tasks are given as runs of identical tasks and are never expanded
+     * runs which are equal for task_comp are interleaved randomly when shuffle is true, and keep their order otherwise
+     */
+    template<typename ProcOrder, typename TaskOrder>
+    auto simulate_runs(
+        std::vector<Processor> procs, ProcOrder proc_comp,
+        std::vector<task_run<SimpleTask>> runs, TaskOrder task_comp,
+        const TaskRunProcessorWithTransfer& tprocessor,
+        const SimpleTask::userid_type n_user_hint,
+        const bool shuffle = true,
+        random_stream generator = random_stream::from_entropy()
+    )
+    {
+        for (auto& l : runs)
+            for (auto& r : runs)
+                if (shuffle && !task_comp(l.task, r.task) && !task_comp(r.task, l.task) && l.task.bits_to_transfer != r.task.bits_to_transfer)
+                {
+                    // tied runs of different tasks can't be placed as a whole, simulate them task by task
+                    return simulate_stream(std::move(procs), proc_comp, std::move(runs), task_comp, tprocessor, n_user_hint, shuffle, generator);
+                }
+
+        using namespace instrumentation;
+        std::vector<task_run_group<SimpleTask>> groups;
+        {
+            scoped_phase timer(phase::sort_tasks);
+            groups = order_task_runs(std::move(runs), task_comp, shuffle);
+        }
+        {
+            scoped_phase timer(phase::sort_procs);
+            std::sort(procs.begin(), procs.end(), proc_comp);
+        }
+
+        std::valarray<double> times(n_user_hint);
+        // identical processors don't need to place tasks at all
+        if (!procs.empty() && analytic::is_homogeneous(procs))
+        {
+            scoped_phase timer(phase::analytic);
+            if (analytic::simulate(procs, groups, tprocessor, times, generator))
+                return times;
+        }
+        scoped_phase timer(phase::engine);
+        return tprocessor(procs, groups, n_user_hint, generator);
+    }
+}
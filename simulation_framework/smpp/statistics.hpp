@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*
+ * Statistics of a sample which is seen one value at a time and isn't stored.
+ */
+namespace smpp
+{
+    /*
+     * count, mean, variance (Welford), min and max;
+     * mean is the sum over the count, so values added in the same order give the same mean as summing them
+     */
+    class running_statistics
+    {
+    public:
+        void add(const double value)
+        {
+            ++n;
+            sum += value;
+            const double delta = value - running_mean;
+            running_mean += delta / n;
+            m2 += delta * (value - running_mean);
+            smallest = std::min(smallest, value);
+            largest = std::max(largest, value);
+        }
+
+        size_t count() const
+        {
+            return n;
+        }
+
+        double mean() const
+        {
+            return n == 0 ? 0.0 : sum / n;
+        }
+
+        // sample variance, 0 for less than two values
+        double variance() const
+        {
+            return n < 2 ? 0.0 : m2 / (n - 1);
+        }
+
+        double standard_deviation() const
+        {
+            return std::sqrt(variance());
+        }
+
+        // half width of the 95% confidence interval of the mean
+        double half_width() const
+        {
+            return n == 0 ? 0.0 : 1.96 * std::sqrt(variance() / n);
+        }
+
+        double min() const
+        {
+            return n == 0 ? 0.0 : smallest;
+        }
+
+        double max() const
+        {
+            return n == 0 ? 0.0 : largest;
+        }
+
+    private:
+        size_t	n				= 0;
+        double	sum				= 0;
+        double	running_mean	= 0;
+        double	m2				= 0;
+        double	smallest		= std::numeric_limits<double>::max();
+        double	largest			= std::numeric_limits<double>::lowest();
+    };
+
+    /*
+     * p quantile by the P2 algorithm (Jain, Chlamtac 1985): five markers at the minimum, p / 2, p, (1 + p) / 2 quantiles
+     * and the maximum are moved towards their desired positions, heights are adjusted by piecewise parabolic interpolation.
+     * The first exact_count values are kept and give the exact quantile, the markers start from their order statistics,
+     * which is much closer than starting from five values when there are a few dozen.
+     */
+    class p2_quantile
+    {
+    public:
+        static constexpr size_t exact_count = 32;
+
+        explicit p2_quantile(const double p)
+            : p(p)
+        {
+
+        }
+
+        void add(const double value)
+        {
+            if (n < exact_count)
+            {
+                first[n++] = value;
+                std::sort(first, first + n);
+                return;
+            }
+            if (n == exact_count)
+                start();
+
+            int k;
+            if (value < height[0])
+            {
+                height[0] = value;
+                k = 0;
+            }
+            else if (value >= height[4])
+            {
+                height[4] = value;
+                k = 3;
+            }
+            else
+            {
+                k = 0;
+                while (value >= height[k + 1])
+                    ++k;
+            }
+            ++n;
+            for (int i = k + 1; i < 5; ++i)
+                ++position[i];
+            for (int i = 0; i < 5; ++i)
+                desired[i] += increment(i);
+
+            for (int i = 1; i < 4; ++i)
+            {
+                const double d = desired[i] - position[i];
+                if ((d >= 1 && position[i + 1] - position[i] > 1) || (d <= -1 && position[i - 1] - position[i] < -1))
+                {
+                    const int step = d > 0 ? 1 : -1;
+                    const double candidate = parabolic(i, step);
+                    if (height[i - 1] < candidate && candidate < height[i + 1])
+                        height[i] = candidate;
+                    else
+                        height[i] += step * (height[i + step] - height[i]) / (position[i + step] - position[i]);
+                    position[i] += step;
+                }
+            }
+        }
+
+        double value() const
+        {
+            if (n == 0)
+                return 0.0;
+            if (n > exact_count)
+                return height[2];
+            // linear interpolation between the sorted values
+            const double at = p * (n - 1);
+            const auto below = size_t(at);
+            if (below + 1 >= n)
+                return first[n - 1];
+            return first[below] + (at - below) * (first[below + 1] - first[below]);
+        }
+
+    private:
+        double increment(const int i) const
+        {
+            return i == 0 ? 0.0 : i == 1 ? p / 2 : i == 2 ? p : i == 3 ? (1 + p) / 2 : 1.0;
+        }
+
+        // markers at the order statistics of the kept values nearest to their desired positions
+        void start()
+        {
+            for (int i = 0; i < 5; ++i)
+            {
+                desired[i] = 1 + (n - 1) * increment(i);
+                double at = std::round(desired[i]);
+                at = std::max(at, i == 0 ? 1.0 : position[i - 1] + 1);
+                at = std::min(at, double(n - (4 - i)));
+                position[i] = at;
+                height[i] = first[size_t(at) - 1];
+            }
+        }
+
+        double parabolic(const int i, const int d) const
+        {
+            return height[i] + double(d) / (position[i + 1] - position[i - 1])
+                * ((position[i] - position[i - 1] + d) * (height[i + 1] - height[i]) / (position[i + 1] - position[i])
+                    + (position[i + 1] - position[i] - d) * (height[i] - height[i - 1]) / (position[i] - position[i - 1]));
+        }
+
+        double	p;
+        size_t	n					= 0;
+        double	first[exact_count]	= {};
+        double	height[5]			= {};
+        double	position[5]			= {};
+        double	desired[5]			= {};
+    };
+
+    /*
+     * running statistics with the 5%, 50% and 95% quantiles of one sample, e.g. replicate times of a user
+     */
+    struct sample_summary
+    {
+        void add(const double value)
+        {
+            moments.add(value);
+            low.add(value);
+            median.add(value);
+            high.add(value);
+        }
+
+        running_statistics	moments;
+        p2_quantile			low		{ 0.05 };
+        p2_quantile			median	{ 0.5 };
+        p2_quantile			high	{ 0.95 };
+    };
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <numeric>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <functional>
+
+#include <smpp/thread_pool.hpp>
+
+namespace smpp
+{
+    /*
+     * Runs simulate(cell, replicate) for every cell and n_replicates replicates on the pool. Results of a cell are folded
+     * into its state, a copy of initial, by fold(state, result) in replicate order as soon as the replicates before them are
+     * done, so only the results which finished early are kept. When the replicates of a cell are done, more(cell, state)
+     * tells how many replicates to add, 0 when the cell is done, and emit(cell, state) is called on the calling thread in
+     * cell order as soon as the cell is done.
+     * The state passed to more doesn't depend on the order jobs finish in, so neither does the number of replicates.
+     * Jobs are started from the most expensive one by cost(cell), added replicates are queued on the worker which asked for them.
+     * At most max_ahead cells (0 - 4 times the pool size) are started which aren't emitted yet, the next ones are started
+     * as cells are emitted, which bounds the queued jobs and the states waiting for an earlier cell, e.g. logs.
+     */
+    template<typename Cell, typename State, typename Simulate, typename Cost, typename Fold, typename More, typename Emit>
+    void run_adaptive_sweep(
+        const std::vector<Cell>& cells,
+        const size_t n_replicates,
+        work_stealing_pool& pool,
+        const State& initial,
+        Simulate simulate,
+        Cost cost,
+        Fold fold,
+        More more,
+        Emit emit,
+        const size_t max_ahead = 0
+    )
+    {
+        typedef decltype(simulate(cells.front(), size_t())) result_type;
+
+        // results of the replicates being run which can't be folded yet, and the number folded of them,
+        // allocated when the cell is started
+        std::vector<std::vector<std::optional<result_type>>> running(cells.size());
+        std::vector<size_t> n_folded(cells.size(), 0);
+        std::vector<State> states(cells.size());
+        std::vector<bool> finished(cells.size(), false);
+        std::exception_ptr error;
+        std::atomic<bool> cancelled{ false };
+        std::mutex mutex;
+        std::condition_variable cell_done;
+
+        // cells started first, the rest is started one by one as cells are emitted
+        const size_t n_ahead = std::min(max_ahead != 0 ? max_ahead : 4 * std::max<size_t>(pool.size(), 1), cells.size());
+        std::vector<size_t> order(n_ahead);
+        std::iota(order.begin(), order.end(), 0);
+        std::vector<size_t> costs;
+        costs.reserve(n_ahead);
+        for (size_t c = 0; c < n_ahead; ++c)
+            costs.push_back(cost(cells[c]));
+        std::stable_sort(order.begin(), order.end(), [&costs](size_t l, size_t r) { return costs[l] > costs[r]; });
+
+        std::function<void(size_t, size_t, size_t)> submit;
+        submit = [&](const size_t c, const size_t first, const size_t count)
+        {
+            for (size_t r = first; r < first + count; ++r)
+                pool.submit([&, c, r, first, count]
+                {
+                    std::optional<result_type> result;
+                    std::exception_ptr e;
+                    try
+                    {
+                        if (!cancelled)
+                            result = simulate(cells[c], r);
+                    }
+                    catch (...)
+                    {
+                        e = std::current_exception();
+                        cancelled = true;
+                    }
+
+                    size_t n_more = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (e && !error)
+                            error = e;
+                        if (cancelled)
+                        {
+                            cell_done.notify_all();
+                            return;
+                        }
+
+                        auto& window = running[c];
+                        window[r - first] = std::move(result);
+                        try
+                        {
+                            for (; n_folded[c] < count && window[n_folded[c]]; ++n_folded[c])
+                            {
+                                fold(states[c], std::move(*window[n_folded[c]]));
+                                window[n_folded[c]].reset();
+                            }
+                            if (n_folded[c] != count)
+                                return;
+                            n_more = more(cells[c], static_cast<const State&>(states[c]));
+                        }
+                        catch (...)
+                        {
+                            error = std::current_exception();
+                            cancelled = true;
+                            cell_done.notify_all();
+                            return;
+                        }
+                        if (n_more != 0)
+                            window.assign(n_more, std::nullopt);
+                        else
+                            std::vector<std::optional<result_type>>().swap(window);
+                        n_folded[c] = 0;
+                        finished[c] = n_more == 0;
+                        cell_done.notify_all();
+                        if (n_more == 0)
+                            return;
+                    }
+                    submit(c, first + count, n_more);
+                });
+        };
+
+        // jobs of other cells don't touch the window and state of a cell which isn't started
+        const auto start = [&](const size_t c)
+        {
+            running[c].assign(n_replicates, std::nullopt);
+            states[c] = initial;
+            submit(c, 0, n_replicates);
+        };
+
+        if (n_replicates == 0)
+            finished.assign(cells.size(), true);
+        else
+            for (auto c : order)
+                start(c);
+
+        try
+        {
+            for (size_t c = 0; c < cells.size(); ++c)
+            {
+                State cell_state;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cell_done.wait(lock, [&] { return finished[c] || error; });
+                    if (error)
+                        std::rethrow_exception(error);
+                    cell_state = n_replicates != 0 ? std::move(states[c]) : initial;
+                    states[c] = State();
+                }
+                if (n_replicates != 0 && c + n_ahead < cells.size())
+                    start(c + n_ahead);
+                emit(cells[c], std::move(cell_state));
+            }
+        }
+        catch (...)
+        {
+            // jobs reference local state, let them finish before leaving
+            cancelled = true;
+            pool.wait();
+            throw;
+        }
+        pool.wait();
+    }
+
+    /*
+     * Runs simulate(cell, replicate) for every cell and replicate on the pool and calls emit(cell, results)
+     * on the calling thread in cell order, with results in replicate order, as soon as all replicates of
+     * the cell are done. Jobs are started from the most expensive one by cost(cell), at most max_ahead cells ahead of emit
+     * (0 - 4 times the pool size).
+     */
+    template<typename Cell, typename Simulate, typename Cost, typename Emit>
+    void run_sweep(
+        const std::vector<Cell>& cells,
+        const size_t n_replicates,
+        work_stealing_pool& pool,
+        Simulate simulate,
+        Cost cost,
+        Emit emit,
+        const size_t max_ahead = 0
+    )
+    {
+        typedef decltype(simulate(cells.front(), size_t())) result_type;
+        run_adaptive_sweep(cells, n_replicates, pool, std::vector<result_type>(), std::move(simulate), std::move(cost),
+            [](std::vector<result_type>& results, result_type&& result) { results.push_back(std::move(result)); },
+            [](const Cell&, const std::vector<result_type>&) { return size_t(0); }, std::move(emit), max_ahead);
+    }
+}
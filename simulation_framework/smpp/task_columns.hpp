@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <smpp/processor.hpp>
+#include <smpp/random.hpp>
+#include <smpp/task.hpp>
+#include <smpp/task_run.hpp>
+#include <smpp/task_completition.hpp>
+
+namespace smpp
+{
+    /*
+     * Tasks stored as one array per field, a task is identified by its 32 bit index.
+     * Shapes of tasks (complexity, bits_to_transfer) are interned into classes, there are only a few of them
+     * in a simulation, so a task is its class and its user, 3 bytes instead of 24 of padded SimpleTask.
+     */
+    struct task_columns
+    {
+        typedef uint32_t	index_type;
+        typedef uint16_t	class_type;
+
+        size_t size() const
+        {
+            return task_class.size();
+        }
+
+        size_t n_classes() const
+        {
+            return classes.size();
+        }
+
+        void clear()
+        {
+            classes.clear();
+            task_class.clear();
+            userid.clear();
+        }
+
+        void reserve(const size_t n)
+        {
+            task_class.reserve(n);
+            userid.reserve(n);
+        }
+
+        // class of the task shape, new shapes get the next class
+        class_type intern(const SimpleTask& task)
+        {
+            for (size_t c = 0; c < classes.size(); ++c)
+                if (classes[c].complexity == task.complexity && classes[c].bits_to_transfer == task.bits_to_transfer)
+                    return class_type(c);
+            if (classes.size() > std::numeric_limits<class_type>::max())
+                throw std::length_error("too many task classes");
+            classes.emplace_back(task.complexity, task.bits_to_transfer, SimpleTask::userid_type(0));
+            return class_type(classes.size() - 1);
+        }
+
+        void push_back(const SimpleTask& task, const size_t count = 1)
+        {
+            task_class.insert(task_class.end(), count, intern(task));
+            userid.insert(userid.end(), count, task.userid);
+        }
+
+        // runs expanded in their order, reuses storage
+        void assign(const std::vector<task_run<SimpleTask>>& runs)
+        {
+            size_t n_tasks = 0;
+            for (auto& run : runs)
+                n_tasks += run.count;
+            clear();
+            reserve(n_tasks);
+            for (auto& run : runs)
+                push_back(run.task, run.count);
+        }
+
+        // tasks of source in the given order, reuses storage
+        void gather(const task_columns& source, const std::vector<index_type>& order)
+        {
+            classes = source.classes;
+            task_class.resize(order.size());
+            userid.resize(order.size());
+            for (size_t i = 0; i < order.size(); ++i)
+                task_class[i] = source.task_class[order[i]];
+            for (size_t i = 0; i < order.size(); ++i)
+                userid[i] = source.userid[order[i]];
+        }
+
+        SimpleTask operator[](const size_t i) const
+        {
+            const auto& shape = classes[task_class[i]];
+            return SimpleTask(shape.complexity, shape.bits_to_transfer, userid[i]);
+        }
+
+        std::vector<SimpleTask>					classes;	// user ids of classes are not used
+        std::vector<class_type>					task_class;
+        std::vector<SimpleTask::userid_type>	userid;
+    };
+
+    /*
+     * Scheduling order of task_columns in O(n) instead of shuffle and sort. Classes are sorted by the task order,
+     * classes tied for it form a group, tasks are bucketed by group. Tasks of a group are shuffled when shuffle is
+     * true and keep their order otherwise, which is the order of a stable sort.
+     * The task order sees only shapes, user ids of the classes are 0, so it must not look at user ids.
+     * Groups of identical tasks, one class of one user, are not shuffled, there is nothing to interleave.
+     */
+    class bucket_order
+    {
+    public:
+        typedef task_columns::index_type index_type;
+
+        template<typename TaskOrder, typename URNG>
+        void operator()(const task_columns& tasks, TaskOrder task_comp, const bool shuffle, URNG& generator, std::vector<index_type>& order)
+        {
+            bucket(tasks, task_comp, order);
+            if (shuffle)
+                shuffle_groups(generator, order);
+        }
+
+        // order of a stable sort, tasks of a group keep their order
+        template<typename TaskOrder>
+        void bucket(const task_columns& tasks, TaskOrder task_comp, std::vector<index_type>& order)
+        {
+            const auto& classes = tasks.classes;
+            class_order.resize(classes.size());
+            std::iota(class_order.begin(), class_order.end(), index_type(0));
+            std::stable_sort(class_order.begin(), class_order.end(), [&classes, &task_comp](const index_type l, const index_type r)
+            {
+                return task_comp(classes[l], classes[r]);
+            });
+
+            group_of_class.resize(classes.size());
+            groups.clear();
+            for (size_t i = 0; i < class_order.size(); ++i)
+            {
+                if (i == 0 || task_comp(classes[class_order[i - 1]], classes[class_order[i]]))
+                    groups.push_back(group());
+                else
+                    groups.back().mixed = true;
+                group_of_class[class_order[i]] = index_type(groups.size() - 1);
+            }
+
+            for (size_t i = 0; i < tasks.size(); ++i)
+            {
+                auto& g = groups[group_of_class[tasks.task_class[i]]];
+                if (g.end++ == 0)
+                    g.user = tasks.userid[i];
+                else if (g.user != tasks.userid[i])
+                    g.mixed = true;
+            }
+            index_type offset = 0;
+            for (auto& g : groups)
+            {
+                g.begin = offset;
+                offset += g.end;
+                g.end = g.begin;
+            }
+
+            order.resize(tasks.size());
+            for (size_t i = 0; i < tasks.size(); ++i)
+                order[groups[group_of_class[tasks.task_class[i]]].end++] = index_type(i);
+        }
+
+        // interleaves tasks of the groups of the last bucket randomly
+        template<typename URNG>
+        void shuffle_groups(URNG& generator, std::vector<index_type>& order) const
+        {
+            for (auto& g : groups)
+                if (g.mixed)
+                    smpp::shuffle(order.begin() + g.begin, order.begin() + g.end, generator);
+        }
+
+        /*
+         * orders the tasks of mixed groups by their keys instead, the identity of a task is its user, its shape and its rank
+         * among the tasks of that user and shape, so simulations sharing the stream and a task draw the same key for it;
+         * an antithetic stream gives the key of a task to the task at the mirrored place of the group, like the mirrored draws
+         * of shuffle_groups it swaps the places of the users, which come one after another before shuffling
+         */
+        void key_groups(const task_columns& tasks, const random_stream& generator, std::vector<index_type>& order)
+        {
+            for (auto& g : groups)
+            {
+                if (!g.mixed)
+                    continue;
+                ranks.clear();
+                keyed.clear();
+                for (auto i = g.begin; i < g.end; ++i)
+                {
+                    const auto task = order[i];
+                    const uint32_t owner = (uint32_t(tasks.task_class[task]) << 8) | tasks.userid[task];
+                    auto rank = std::find_if(ranks.begin(), ranks.end(), [owner](const std::pair<uint32_t, uint64_t>& r) { return r.first == owner; });
+                    if (rank == ranks.end())
+                        rank = ranks.insert(ranks.end(), std::make_pair(owner, uint64_t(0)));
+                    const auto& shape = tasks.classes[tasks.task_class[task]];
+                    uint64_t complexity;
+                    static_assert(sizeof(complexity) == sizeof(shape.complexity), "complexity is hashed as its bits");
+                    std::memcpy(&complexity, &shape.complexity, sizeof(complexity));
+                    keyed.emplace_back(generator.key({ tasks.userid[task], complexity, uint64_t(shape.bits_to_transfer), rank->second++ }), task);
+                }
+                if (generator.is_antithetic())
+                    for (size_t k = 0; k < keyed.size() / 2; ++k)
+                        std::swap(keyed[k].first, keyed[keyed.size() - 1 - k].first);
+                sort_keyed();
+                for (size_t k = 0; k < keyed.size(); ++k)
+                    order[g.begin + k] = keyed[k].second;
+            }
+        }
+
+    private:
+        // keys are uniform, so bucketing them by their top bits leaves about one per bucket, and insertion sorts the rest
+        void sort_keyed()
+        {
+            unsigned bits = 1;
+            while (bits < 32 && (size_t(1) << bits) < keyed.size())
+                ++bits;
+            bucket_end.assign((size_t(1) << bits) + 1, 0);
+            for (auto& k : keyed)
+                ++bucket_end[(k.first >> (64 - bits)) + 1];
+            std::partial_sum(bucket_end.begin(), bucket_end.end(), bucket_end.begin());
+            sorted_keyed.resize(keyed.size());
+            for (auto& k : keyed)
+                sorted_keyed[bucket_end[k.first >> (64 - bits)]++] = k;
+            for (size_t i = 1; i < sorted_keyed.size(); ++i)
+                for (size_t j = i; j > 0 && sorted_keyed[j] < sorted_keyed[j - 1]; --j)
+                    std::swap(sorted_keyed[j], sorted_keyed[j - 1]);
+            keyed.swap(sorted_keyed);
+        }
+
+        struct group
+        {
+            index_type					begin	= 0;
+            index_type					end		= 0;	// number of tasks until they are bucketed
+            SimpleTask::userid_type		user	= 0;
+            bool						mixed	= false;
+        };
+
+        std::vector<index_type>		class_order;
+        std::vector<index_type>		group_of_class;
+        std::vector<group>			groups;
+        // (class << 8 | user, tasks of it seen) and (key, task) of the group being keyed
+        std::vector<std::pair<uint32_t, uint64_t>>		ranks;
+        std::vector<std::pair<uint64_t, index_type>>	keyed;
+        std::vector<std::pair<uint64_t, index_type>>	sorted_keyed;
+        std::vector<size_t>								bucket_end;
+    };
+
+    /*
+     * time to process every task class on every processor, filled once per simulation,
+     * row of a processor is contiguous
+     */
+    class duration_table
+    {
+    public:
+        // only first n_procs processors get rows, processors which never get a task don't need them
+        template<typename Engine>
+        void fill(const Engine& tprocessor, const std::vector<Processor>& procs, const size_t n_procs, const std::vector<SimpleTask>& classes)
+        {
+            n_classes = classes.size();
+            values.resize(n_procs * n_classes);
+            for (size_t p = 0; p < n_procs; ++p)
+                for (size_t c = 0; c < n_classes; ++c)
+                    values[p * n_classes + c] = tprocessor.time_to_process(procs[p], classes[c]);
+        }
+
+        double operator()(const size_t proc, const task_columns::class_type task_class) const
+        {
+            return values[proc * n_classes + task_class];
+        }
+
+    private:
+        size_t				n_classes = 0;
+        std::vector<double>	values;
+    };
+
+    /*
+     * event of the engine working on task_columns, 24 bytes instead of 40 of task_completition<SimpleTask*>
+     */
+    struct column_event
+    {
+        struct later_first
+        {
+            constexpr bool operator()(const column_event& l, const column_event& r)
+            {
+                return l.time_end > r.time_end;
+            }
+        };
+
+        column_event(const double time_start, const double time_end, const uint32_t worker_index, const task_columns::index_type task)
+            : time_start(time_start), time_end(time_end), worker_index(worker_index), task(task)
+        {
+
+        }
+
+        double						time_start;
+        double						time_end;
+        uint32_t					worker_index;
+        task_columns::index_type	task;
+    };
+
+    inline double event_time(const column_event& e)
+    {
+        return e.time_end;
+    }
+
+    /*
+     * completion log of the engine working on task_columns, one array per field
+     */
+    struct completion_columns
+    {
+        size_t size() const
+        {
+            return time_end.size();
+        }
+
+        void clear()
+        {
+            time_start.clear();
+            time_end.clear();
+            worker_index.clear();
+            task.clear();
+        }
+
+        void reserve(const size_t n)
+        {
+            time_start.reserve(n);
+            time_end.reserve(n);
+            worker_index.reserve(n);
+            task.reserve(n);
+        }
+
+        void push_back(const column_event& e)
+        {
+            time_start.push_back(e.time_start);
+            time_end.push_back(e.time_end);
+            worker_index.push_back(e.worker_index);
+            task.push_back(e.task);
+        }
+
+        // i-th completion as a task_completition, tasks are the columns the engine worked on
+        task_completition<SimpleTask> record(const size_t i, const task_columns& tasks) const
+        {
+            return task_completition<SimpleTask>(time_start[i], time_end[i], worker_index[i], tasks[task[i]]);
+        }
+
+        std::vector<double>						time_start;
+        std::vector<double>						time_end;
+        std::vector<uint32_t>					worker_index;
+        std::vector<task_columns::index_type>	task;
+    };
+}
@@ -56,5 +56,9 @@ namespace smpp
         Task	task;
     };
 
-    
+    template<typename Task>
+    double event_time(const task_completition<Task>& tc)
+    {
+        return tc.time_end;
+    }
 }
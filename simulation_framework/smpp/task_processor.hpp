@@ -1,11 +1,15 @@
 #pragma once
 
 #include <functional>
+#include <algorithm>
 
 #include <smpp/processor.hpp>
 #include <smpp/task.hpp>
 #include <smpp/priority_queue.hpp>
+#include <smpp/event_queue.hpp>
 #include <smpp/task_completition.hpp>
+#include <smpp/task_columns.hpp>
+#include <smpp/instrumentation.hpp>
 
 
 
@@ -20,16 +24,23 @@ namespace smpp
         
 
         virtual return_type operator()(const std::vector<Processor>& procs, std::vector<task>& tasks) const = 0;
+
+        virtual double time_to_process(const Processor& proc, const task& t) const = 0;
     };
 
-    struct TaskProcessorWithTransfer : TaskProcessor
+    /*
+     * QueuePolicy::type<Type, Compare> is the event queue, see event_queue.hpp
+     */
+    template<typename QueuePolicy = binary_heap_queue>
+    struct BasicTaskProcessorWithTransfer : TaskProcessor
     {
         typedef TaskProcessor::task			task;
         typedef TaskProcessor::task_ptr		task_ptr;
-        typedef TaskProcessor::task_queue	task_queue;
+        typedef typename QueuePolicy::template type<task_completition<task_ptr>, typename task_completition<task_ptr>::later_first> task_queue;
         typedef TaskProcessor::return_type	return_type;
+        typedef typename QueuePolicy::template type<column_event, column_event::later_first> column_queue;
 
-        TaskProcessorWithTransfer(
+        BasicTaskProcessorWithTransfer(
             double bandwidth		= 8e8,      // ~100 mbit/s
             double connection_setup = 0.00001   // time to setup connection
 
@@ -43,20 +54,49 @@ namespace smpp
             return bits_to_transfer / bandwidth + connection_setup;
         }
 
-        return_type operator()(const std::vector<Processor>& procs, std::vector<task>& tasks) const override
+        double time_to_process(const Processor& proc, const task& t) const override final
+        {
+            return
+                proc.time_to_complete(t.complexity)	//main processing time
+                +
+                transfer_time(t.bits_to_transfer)	// time for data transfer
+                ;
+        }
+
+        return_type operator()(const std::vector<Processor>& procs, std::vector<task>& tasks) const override final
         {
             task_queue p_queue;
             return_type processed_tasks;
+            (*this)(procs, tasks, processed_tasks, p_queue);
+            return processed_tasks;
+        }
+
+        /*
+         * same as above, but reuses storage of processed_tasks and p_queue, both are cleared first
+         */
+        void operator()(const std::vector<Processor>& procs, std::vector<task>& tasks, return_type& processed_tasks, task_queue& p_queue) const
+        {
+            processed_tasks.clear();
             processed_tasks.reserve(tasks.size());
+            (*this)(procs, tasks, p_queue, [&processed_tasks](task_completition<task_ptr>& tk)
+            {
+                processed_tasks.push_back(std::move(tk));
+            });
+        }
+
+        /*
+         * passes every completed task_completition<task_ptr> to on_complete in completion order instead of storing them,
+         * p_queue is cleared first
+         */
+        template<typename OnComplete>
+        void operator()(const std::vector<Processor>& procs, std::vector<task>& tasks, task_queue& p_queue, OnComplete&& on_complete) const
+        {
+            p_queue.clear();
 
             auto task_iterator = tasks.begin();
             for (size_t i = 0; i < procs.size() && task_iterator != tasks.end(); ++i)
             {
-                const auto time_to_process =
-                    procs[i].time_to_complete(task_iterator->complexity)	//main processing time
-                    +
-                    transfer_time(task_iterator->bits_to_transfer)			// time for data transfer
-                    ;
+                const auto time_to_process = BasicTaskProcessorWithTransfer::time_to_process(procs[i], *task_iterator);
                 p_queue.emplace(0.0, time_to_process, i, &(*task_iterator));
                 ++task_iterator;
             }
@@ -66,21 +106,92 @@ namespace smpp
                 auto tk = p_queue.pop();
                 if (task_iterator != tasks.end())
                 {
-                    const auto time_to_process = 
-                        procs[tk.worker_index].time_to_complete(task_iterator->complexity)	//main processing time
-                        +
-                        transfer_time(task_iterator->bits_to_transfer)						// time for data transfer
-                        ;
+                    const auto time_to_process = BasicTaskProcessorWithTransfer::time_to_process(procs[tk.worker_index], *task_iterator);
                     p_queue.emplace(tk.time_end, tk.time_end + time_to_process, tk.worker_index, &(*task_iterator));
                     ++task_iterator;
                 }
-                processed_tasks.push_back(std::move(tk));
+                on_complete(tk);
             }
 
-            return processed_tasks;
+            // every task is pushed and popped once
+            instrumentation::count(instrumentation::counter::queue_push, task_iterator - tasks.begin());
+            instrumentation::count(instrumentation::counter::queue_pop, task_iterator - tasks.begin());
+        }
+
+        /*
+         * same as above for tasks stored as columns, on_complete gets column_event
+         * durations are looked up in durations, which are filled first
+         */
+        template<typename OnComplete>
+        void operator()(const std::vector<Processor>& procs, const task_columns& tasks, column_queue& p_queue, duration_table& durations, OnComplete&& on_complete) const
+        {
+            p_queue.clear();
+
+            const auto n_tasks = static_cast<task_columns::index_type>(tasks.size());
+            const auto n_used = std::min<size_t>(procs.size(), n_tasks);
+            durations.fill(*this, procs, n_used, tasks.classes);
+
+            const auto* task_class = tasks.task_class.data();
+            task_columns::index_type next = 0;
+            for (uint32_t i = 0; i < n_used; ++i, ++next)
+                p_queue.emplace(0.0, durations(i, task_class[next]), i, next);
+
+            while (!p_queue.empty())
+            {
+                auto e = p_queue.pop();
+                if (next != n_tasks)
+                {
+                    p_queue.emplace(e.time_end, e.time_end + durations(e.worker_index, task_class[next]), e.worker_index, next);
+                    ++next;
+                }
+                on_complete(e);
+            }
+
+            instrumentation::count(instrumentation::counter::queue_push, next);
+            instrumentation::count(instrumentation::counter::queue_pop, next);
+        }
+
+        /*
+         * takes tasks from stream (bool next(task&)) in scheduling order and passes every completed
+         * task_completition<task> to on_complete in completion order; keeps only the running tasks
+         */
+        template<typename Stream, typename OnComplete>
+        void operator()(const std::vector<Processor>& procs, Stream& stream, OnComplete&& on_complete) const
+        {
+            typedef typename QueuePolicy::template type<task_completition<task>, typename task_completition<task>::later_first> stream_queue;
+            stream_queue p_queue;
+
+            size_t n_pushed = 0;
+            task next_task(0.0, 0, 0);
+            for (size_t i = 0; i < procs.size() && stream.next(next_task); ++i)
+            {
+                const auto time_to_process = BasicTaskProcessorWithTransfer::time_to_process(procs[i], next_task);
+                p_queue.emplace(0.0, time_to_process, i, std::move(next_task));
+                ++n_pushed;
+            }
+
+            while (!p_queue.empty())
+            {
+                auto tk = p_queue.pop();
+                if (stream.next(next_task))
+                {
+                    const auto time_to_process = BasicTaskProcessorWithTransfer::time_to_process(procs[tk.worker_index], next_task);
+                    p_queue.emplace(tk.time_end, tk.time_end + time_to_process, tk.worker_index, std::move(next_task));
+                    ++n_pushed;
+                }
+                on_complete(tk);
+            }
+
+            instrumentation::count(instrumentation::counter::queue_push, n_pushed);
+            instrumentation::count(instrumentation::counter::queue_pop, n_pushed);
         }
 
         double bandwidth;
         double connection_setup;
     };
+
+    typedef BasicTaskProcessorWithTransfer<>						TaskProcessorWithTransfer;
+    typedef BasicTaskProcessorWithTransfer<radix_heap_queue>		TaskProcessorWithTransferRadixHeap;
+    typedef BasicTaskProcessorWithTransfer<tournament_tree_queue>	TaskProcessorWithTransferTournamentTree;
+    typedef BasicTaskProcessorWithTransfer<calendar_queue_queue>	TaskProcessorWithTransferCalendarQueue;
 }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+namespace smpp
+{
+    /*
+     * count identical copies of task
+     */
+    template<typename Task>
+    struct task_run
+    {
+        task_run(Task task, const size_t count)
+            : task(std::move(task)), count(count)
+        {
+
+        }
+
+        task_run(const task_run&) = default;
+        task_run(task_run&&) = default;
+        task_run& operator=(task_run&&) = default;
+        task_run& operator=(const task_run&) = default;
+
+        template<typename Compare>
+        struct task_compare
+        {
+            explicit task_compare(Compare compare = Compare())
+                : comparator(std::move(compare))
+            {
+
+            }
+
+            bool operator()(const task_run& l, const task_run& r) const
+            {
+                return comparator(l.task, r.task);
+            }
+
+            Compare comparator;
+        };
+
+        Task	task;
+        size_t	count;
+    };
+
+    /*
+     * runs of identical tasks which are equal for task ordering and so are interleaved between their owners
+     */
+    template<typename Task>
+    using task_run_group = std::vector<task_run<Task>>;
+
+    // reuses storage of tasks
+    template<typename Task>
+    void expand_task_runs(const std::vector<task_run<Task>>& runs, std::vector<Task>& tasks)
+    {
+        size_t n_tasks = 0;
+        for (auto& run : runs)
+            n_tasks += run.count;
+
+        tasks.clear();
+        tasks.reserve(n_tasks);
+        for (auto& run : runs)
+            tasks.insert(tasks.end(), run.count, run.task);
+    }
+
+    template<typename Task>
+    std::vector<Task> expand_task_runs(const std::vector<task_run<Task>>& runs)
+    {
+        std::vector<Task> tasks;
+        expand_task_runs(runs, tasks);
+        return tasks;
+    }
+
+    /*
+     * sorts runs by task order; runs which are equal for task_comp go to one group when interleave_tied is true,
+     * and keep their own groups in the order of creation otherwise
+     */
+    template<typename Task, typename TaskOrder>
+    std::vector<task_run_group<Task>> order_task_runs(std::vector<task_run<Task>> runs, TaskOrder task_comp, const bool interleave_tied)
+    {
+        std::stable_sort(runs.begin(), runs.end(), typename task_run<Task>::template task_compare<TaskOrder>(task_comp));
+
+        std::vector<task_run_group<Task>> groups;
+        for (auto& r : runs)
+        {
+            const bool tied = interleave_tied && !groups.empty()
+                && !task_comp(groups.back().back().task, r.task) && !task_comp(r.task, groups.back().back().task);
+            if (tied)
+                groups.back().push_back(std::move(r));
+            else
+                groups.emplace_back(1, std::move(r));
+        }
+        return groups;
+    }
+}
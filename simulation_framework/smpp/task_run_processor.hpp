@@ -0,0 +1,219 @@
+#pragma once
+
+#include <vector>
+#include <valarray>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include <smpp/processor.hpp>
+#include <smpp/task.hpp>
+#include <smpp/task_run.hpp>
+#include <smpp/priority_queue.hpp>
+#include <smpp/task_processor.hpp>
+#include <smpp/random.hpp>
+
+namespace smpp
+{
+    /*
+     * Same greedy schedule as TaskProcessorWithTransfer (next task goes to the processor which is free first),
+     * but whole groups of identical tasks are placed at once instead of one queue event per task.
+     * Start times are computed as free_time + k * duration, so they may differ from the event loop in the last bits.
+     */
+    struct TaskRunProcessorWithTransfer : TaskProcessorWithTransfer
+    {
+        typedef TaskProcessor::task task;
+        typedef task_run<task>		run;
+        typedef task_run_group<task>	run_group;
+
+        using BasicTaskProcessorWithTransfer::BasicTaskProcessorWithTransfer;
+        using TaskProcessorWithTransfer::operator();
+
+        /*
+         * returns time of the last completed task of each user
+         * tasks of the runs inside one group are assigned to the group slots in random order
+         */
+        template<typename URNG>
+        std::valarray<double> operator()(
+            const std::vector<Processor>& procs,
+            const std::vector<run_group>& groups,
+            const task::userid_type n_users,
+            URNG& generator
+        ) const
+        {
+            std::valarray<double> times(n_users);
+            std::vector<double> free_time(procs.size(), 0.0);
+            std::vector<double> duration(procs.size());
+            std::vector<size_t> assigned(procs.size());
+
+            for (auto& group : groups)
+            {
+                size_t n_tasks = 0;
+                for (auto& r : group)
+                    n_tasks += r.count;
+                if (n_tasks == 0 || procs.empty())
+                    continue;
+
+                const auto& prototype = group.front().task;
+                for (size_t i = 0; i < procs.size(); ++i)
+                    duration[i] = TaskProcessorWithTransfer::time_to_process(procs[i], prototype);
+                std::fill(assigned.begin(), assigned.end(), 0);
+
+                const auto n_bulk = assign_bulk(free_time, duration, assigned, n_tasks);
+                assign_one_by_one(free_time, duration, assigned, n_tasks - n_bulk);
+
+                if (group.size() == 1)
+                {
+                    auto& time = times[group.front().task.userid];
+                    for (size_t i = 0; i < procs.size(); ++i)
+                        if (assigned[i] != 0)
+                            time = std::max(time, free_time[i]);
+                }
+                else
+                {
+                    label_group(group, n_tasks, free_time, duration, assigned, times, generator);
+                }
+            }
+
+            return times;
+        }
+
+    private:
+        static size_t count_started_before(const double bound, const std::vector<double>& free_time, const std::vector<double>& duration, std::vector<size_t>* per_proc = nullptr)
+        {
+            size_t result = 0;
+            for (size_t i = 0; i < free_time.size(); ++i)
+            {
+                const size_t n = bound > free_time[i] ? static_cast<size_t>(std::ceil((bound - free_time[i]) / duration[i])) : 0;
+                if (per_proc)
+                    (*per_proc)[i] = n;
+                result += n;
+            }
+            return result;
+        }
+
+        /*
+         * places every task which starts strictly before the bound, where the bound is the largest one
+         * which doesn't exceed n_tasks; returns number of placed tasks
+         */
+        static size_t assign_bulk(std::vector<double>& free_time, const std::vector<double>& duration, std::vector<size_t>& assigned, const size_t n_tasks)
+        {
+            if (n_tasks <= free_time.size())
+                return 0;
+
+            const double lo_start = *std::min_element(free_time.begin(), free_time.end());
+            const double step = *std::min_element(duration.begin(), duration.end());
+            double lo = lo_start;
+            double hi = lo_start + step;
+            while (count_started_before(hi, free_time, duration) < n_tasks)
+                hi = lo_start + 2.0 * (hi - lo_start);
+
+            for (;;)
+            {
+                const double mid = lo + (hi - lo) / 2.0;
+                if (!(lo < mid && mid < hi))
+                    break;
+                if (count_started_before(mid, free_time, duration) <= n_tasks)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+
+            const auto n_bulk = count_started_before(lo, free_time, duration, &assigned);
+            for (size_t i = 0; i < free_time.size(); ++i)
+                free_time[i] += assigned[i] * duration[i];
+            return n_bulk;
+        }
+
+        static void assign_one_by_one(std::vector<double>& free_time, const std::vector<double>& duration, std::vector<size_t>& assigned, size_t n_tasks)
+        {
+            if (n_tasks == 0)
+                return;
+
+            typedef std::pair<double, size_t> slot;
+            priority_queue<slot, std::greater<slot>> p_queue;
+            for (size_t i = 0; i < free_time.size(); ++i)
+                p_queue.emplace(free_time[i], i);
+
+            for (; n_tasks != 0; --n_tasks)
+            {
+                auto s = p_queue.pop();
+                free_time[s.second] = s.first + duration[s.second];
+                ++assigned[s.second];
+                p_queue.emplace(free_time[s.second], s.second);
+            }
+        }
+
+        /*
+         * walks group slots from the latest end until every owner is met, drawing owner of each slot
+         * without replacement, which is the same as labeling slots by random permutation
+         */
+        template<typename URNG>
+        static void label_group(
+            const run_group& group,
+            size_t n_tasks,
+            const std::vector<double>& free_time,
+            const std::vector<double>& duration,
+            const std::vector<size_t>& assigned,
+            std::valarray<double>& times,
+            URNG& generator
+        )
+        {
+            struct slot
+            {
+                double time_end;
+                size_t worker_index;
+                size_t left;
+
+                bool operator<(const slot& r) const
+                {
+                    return time_end < r.time_end;
+                }
+            };
+
+            priority_queue<slot> latest;
+            for (size_t i = 0; i < free_time.size(); ++i)
+                if (assigned[i] != 0)
+                    latest.push(slot{ free_time[i], i, assigned[i] });
+
+            std::vector<size_t> left;
+            left.reserve(group.size());
+            for (auto& r : group)
+                left.push_back(r.count);
+            std::vector<bool> seen(group.size(), false);
+            size_t n_seen = 0;
+            for (size_t i = 0; i < group.size(); ++i)
+                if (group[i].count == 0)
+                {
+                    seen[i] = true;
+                    ++n_seen;
+                }
+
+            while (n_seen != group.size())
+            {
+                auto s = latest.pop();
+                auto draw = uniform_index(generator, n_tasks);
+                size_t owner = 0;
+                while (draw >= left[owner])
+                    draw -= left[owner++];
+                --left[owner];
+                --n_tasks;
+
+                if (!seen[owner])
+                {
+                    seen[owner] = true;
+                    ++n_seen;
+                    auto& time = times[group[owner].task.userid];
+                    time = std::max(time, s.time_end);
+                }
+
+                if (--s.left != 0)
+                {
+                    s.time_end -= duration[s.worker_index];
+                    latest.push(s);
+                }
+            }
+        }
+    };
+}
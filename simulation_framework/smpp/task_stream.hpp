@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include <smpp/task_run.hpp>
+#include <smpp/random.hpp>
+
+namespace smpp
+{
+    /*
+     * Yields tasks one by one in scheduling order without materialising them, memory is O(runs).
+     * Tasks of tied runs are drawn without replacement, which gives the same random order
+     * as shuffling the expanded tasks before a sort.
+     */
+    template<typename Task, typename URNG>
+    class task_stream
+    {
+    public:
+        typedef Task						value_type;
+        typedef task_run_group<Task>		group_type;
+
+        template<typename TaskOrder>
+        task_stream(std::vector<task_run<Task>> runs, TaskOrder task_comp, const bool shuffle, URNG& generator)
+            : groups(order_task_runs(std::move(runs), task_comp, shuffle)), generator(generator)
+        {
+            for (auto& group : groups)
+                for (auto& r : group)
+                    n_left += r.count;
+            start_group();
+        }
+
+        bool next(Task& task)
+        {
+            while (left_in_group == 0)
+            {
+                if (group_index == groups.size())
+                    return false;
+                ++group_index;
+                start_group();
+            }
+
+            auto& group = groups[group_index];
+            size_t owner = 0;
+            if (group.size() != 1)
+            {
+                auto draw = uniform_index(generator, left_in_group);
+                while (draw >= group[owner].count)
+                    draw -= group[owner++].count;
+            }
+            --group[owner].count;
+            --left_in_group;
+            --n_left;
+            task = group[owner].task;
+            return true;
+        }
+
+        size_t remaining() const
+        {
+            return n_left;
+        }
+
+    private:
+        void start_group()
+        {
+            left_in_group = 0;
+            if (group_index == groups.size())
+                return;
+            for (auto& r : groups[group_index])
+                left_in_group += r.count;
+        }
+
+        std::vector<group_type>	groups;
+        URNG&					generator;
+        size_t					group_index		= 0;
+        size_t					left_in_group	= 0;
+        size_t					n_left			= 0;
+    };
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace smpp
+{
+    /*
+     * Every worker has its own queue, it takes jobs from the back of it, idle workers steal from the front of other queues.
+     * Jobs submitted by a worker are pushed to the back of its own queue, so they run next on the same thread.
+     * Jobs submitted from outside are pushed to the front of the queues round robin, so jobs submitted in order of
+     * decreasing cost are started roughly in that order.
+     * A queue is locked only by its owner and the workers stealing from it, the pool-wide mutex only by workers
+     * going to sleep and by whoever wakes them.
+     */
+    class work_stealing_pool
+    {
+    public:
+        typedef std::function<void()> job;
+
+        explicit work_stealing_pool(size_t n_threads = std::thread::hardware_concurrency())
+        {
+            if (n_threads == 0)
+                n_threads = 1;
+            for (size_t i = 0; i < n_threads; ++i)
+                queues.push_back(std::make_unique<job_queue>());
+            for (size_t i = 0; i < n_threads; ++i)
+                threads.emplace_back([this, i] { work(i); });
+        }
+
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+        ~work_stealing_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            has_work.notify_all();
+            for (auto& t : threads)
+                t.join();
+        }
+
+        void submit(job j)
+        {
+            ++n_pending;
+            // counted before it's pushed, so n_queued never drops below the jobs in the queues
+            ++n_queued;
+            if (current_pool == this)
+                queues[current_index]->push_back(std::move(j));
+            else
+                queues[next_queue++ % queues.size()]->push_front(std::move(j));
+
+            // a worker going to sleep counts itself before it checks n_queued, so either it sees the job or it's woken
+            if (n_sleeping != 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                has_work.notify_one();
+            }
+        }
+
+        // waits for all submitted jobs, rethrows the first exception thrown by a job
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            all_done.wait(lock, [this] { return n_pending == 0; });
+            if (error)
+            {
+                auto e = error;
+                error = nullptr;
+                std::rethrow_exception(e);
+            }
+        }
+
+        size_t size() const
+        {
+            return threads.size();
+        }
+
+    private:
+        class job_queue
+        {
+        public:
+            void push_back(job&& j)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(j));
+                n_jobs = jobs.size();
+            }
+
+            void push_front(job&& j)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_front(std::move(j));
+                n_jobs = jobs.size();
+            }
+
+            bool pop_back(job& j)
+            {
+                if (n_jobs == 0)
+                    return false;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (jobs.empty())
+                    return false;
+                j = std::move(jobs.back());
+                jobs.pop_back();
+                n_jobs = jobs.size();
+                return true;
+            }
+
+            bool pop_front(job& j)
+            {
+                if (n_jobs == 0)
+                    return false;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (jobs.empty())
+                    return false;
+                j = std::move(jobs.front());
+                jobs.pop_front();
+                n_jobs = jobs.size();
+                return true;
+            }
+
+        private:
+            std::mutex			mutex;
+            std::deque<job>		jobs;
+            // lets thieves skip empty queues without locking them
+            std::atomic<size_t>	n_jobs{ 0 };
+        };
+
+        bool take(const size_t index, job& j)
+        {
+            if (queues[index]->pop_back(j))
+                return true;
+            for (size_t k = 1; k < queues.size(); ++k)
+                if (queues[(index + k) % queues.size()]->pop_front(j))
+                    return true;
+            return false;
+        }
+
+        void work(const size_t index)
+        {
+            current_pool = this;
+            current_index = index;
+            for (;;)
+            {
+                job j;
+                if (!take(index, j))
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ++n_sleeping;
+                    has_work.wait(lock, [this] { return stop || n_queued != 0; });
+                    --n_sleeping;
+                    if (n_queued == 0)
+                        return;
+                    continue;
+                }
+                --n_queued;
+
+                try
+                {
+                    j();
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+
+                if (--n_pending == 0)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    all_done.notify_all();
+                }
+            }
+        }
+
+        // the pool and the queue of the worker running on this thread
+        static inline thread_local work_stealing_pool*	current_pool	= nullptr;
+        static inline thread_local size_t				current_index	= 0;
+
+        std::vector<std::unique_ptr<job_queue>>	queues;
+        std::vector<std::thread>				threads;
+        std::atomic<size_t>						next_queue{ 0 };
+        // jobs in the queues, jobs submitted and not finished, workers waiting for a job
+        std::atomic<size_t>						n_queued{ 0 };
+        std::atomic<size_t>						n_pending{ 0 };
+        std::atomic<size_t>						n_sleeping{ 0 };
+
+        std::mutex								mutex;
+        std::condition_variable					has_work;
+        std::condition_variable					all_done;
+        bool									stop		= false;
+        std::exception_ptr						error;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <valarray>
+
+#include <smpp/task_completition.hpp>
+
+namespace smpp
+{
+    /*
+     * Completion handler of the engines which keeps only per user state: time of the last completed task
+     * and number of tasks not completed yet. Completions come in order of time_end, so the last one of a user
+     * is the time the user is done.
+     */
+    class user_completion
+    {
+    public:
+        void reset(const size_t n_users)
+        {
+            if (end_times.size() != n_users)
+                end_times.resize(n_users);
+            end_times = 0.0;
+            outstanding.assign(n_users, 0);
+            n_finished = 0;
+        }
+
+        // resets and counts tasks of every user
+        template<typename Tasks>
+        void reset(const size_t n_users, const Tasks& tasks)
+        {
+            reset(n_users);
+            for (auto& t : tasks)
+                expect(get_ref(t).userid, 1);
+        }
+
+        void expect(const size_t user, const size_t count)
+        {
+            outstanding[user] += count;
+        }
+
+        void complete(const size_t user, const double time_end)
+        {
+            end_times[user] = time_end;
+            if (outstanding[user] != 0 && --outstanding[user] == 0)
+                ++n_finished;
+        }
+
+        template<typename Task>
+        void operator()(const task_completition<Task>& tc)
+        {
+            complete(get_ref(tc.task).userid, tc.time_end);
+        }
+
+        bool finished(const size_t user) const
+        {
+            return outstanding[user] == 0;
+        }
+
+        size_t users_finished() const
+        {
+            return n_finished;
+        }
+
+        const std::valarray<double>& times() const
+        {
+            return end_times;
+        }
+
+    private:
+        std::valarray<double>	end_times;
+        std::vector<size_t>		outstanding;
+        size_t					n_finished = 0;
+    };
+}
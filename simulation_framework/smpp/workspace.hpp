@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <valarray>
+#include <list>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include <smpp/processor.hpp>
+#include <smpp/task.hpp>
+#include <smpp/task_run.hpp>
+#include <smpp/task_columns.hpp>
+#include <smpp/mmsim.hpp>
+#include <smpp/task_processor.hpp>
+#include <smpp/user_completion.hpp>
+#include <smpp/instrumentation.hpp>
+
+namespace smpp
+{
+    /*
+     * Buffers of one simulation which are kept between replicates: sorted processors, tasks of the last cell
+     * in creation order, their scheduling order, its buckets and sorted copy, engine queue and duration table, completions
+     * (only when they are asked for) and per user results. Tasks and completions are stored as columns, see task_columns.hpp.
+     * Nothing is reallocated while the cell and the number of processors stay the same.
+     * One workspace per thread.
+     */
+    template<typename Engine>
+    struct SimulationWorkspace
+    {
+        typedef typename Engine::column_queue	task_queue;
+        typedef task_columns::index_type		index_type;
+
+        // tasks of the cell in creation order, they are created only when the cell changes
+        const task_columns& load_tasks(const size_t problem_size, const std::list<size_t>& slice_sizes)
+        {
+            instrumentation::scoped_phase timer(instrumentation::phase::create_tasks);
+            if (problem_size != cell_problem_size || slice_sizes != cell_slice_sizes || base_tasks.size() == 0)
+            {
+                if (mmsim::calculate_number_of_tasks(problem_size, slice_sizes) > std::numeric_limits<index_type>::max())
+                    throw std::length_error("too many tasks for 32 bit task indices");
+                base_tasks.assign(mmsim::create_task_runs<SimpleTask>(problem_size, slice_sizes));
+                cell_problem_size	= problem_size;
+                cell_slice_sizes	= slice_sizes;
+            }
+            return base_tasks;
+        }
+
+        template<typename ProcOrder>
+        const std::vector<Processor>& load_processors(const std::vector<Processor>& source, ProcOrder proc_comp)
+        {
+            instrumentation::scoped_phase timer(instrumentation::phase::sort_procs);
+            procs.assign(source.begin(), source.end());
+            std::sort(procs.begin(), procs.end(), proc_comp);
+            return procs;
+        }
+
+        std::valarray<double>& reset_times(const size_t n_users)
+        {
+            if (times.size() != n_users)
+                times.resize(n_users);
+            times = 0.0;
+            return times;
+        }
+
+        std::vector<Processor>		procs;
+        task_columns				base_tasks;
+        bucket_order				ordering;
+        std::vector<index_type>		order;		// indices of base_tasks in scheduling order
+        task_columns				tasks;		// base_tasks in scheduling order
+        task_queue					queue;
+        duration_table				durations;
+        completion_columns			completions;
+        user_completion				users;
+        std::valarray<double>		times;
+
+    private:
+        size_t						cell_problem_size = 0;
+        std::list<size_t>			cell_slice_sizes;
+    };
+}